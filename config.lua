@@ -31,6 +31,23 @@ statusTimeout = 5000
 replaceKickOnLogin = "yes"
 maxPacketsPerSecond = 25
 
+-- NOTE: outputFlushPolicy "frame" writes every packet queued for a player at
+-- the end of each dispatcher frame, "threshold" holds packets back for up to
+-- 10 ms unless outputFlushThreshold bytes are already waiting
+-- maxQueuedOutputBytes disconnects a player whose client falls behind by
+-- that many bytes waiting to be written, 0 disables the limit and leaves
+-- slow clients to the write timeout
+outputFlushPolicy = "threshold"
+outputFlushThreshold = 8192
+maxQueuedOutputBytes = 0
+
+-- NOTE: networkThreads sets how many threads handle connections, new
+-- connections are spread over them. networkReusePort gives every thread its
+-- own listening socket (SO_REUSEPORT) so the kernel balances accepts too,
+-- this is only available on Linux
+networkThreads = 1
+networkReusePort = "no"
+
 -- Deaths
 -- NOTE: Leave deathLosePercent as -1 if you want to use the default
 -- death penalty formula. For the old formula, set it to 10. For
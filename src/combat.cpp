@@ -129,7 +129,7 @@ CombatDamage Combat::getCombatDamage(Creature* creature, Creature* target) const
 }
 
 void Combat::getCombatArea(const Position& centerPos, const Position& targetPos, const AreaCombat* area,
-                           std::list<Tile*>& list)
+                           std::list<Position>& list)
 {
 	if (targetPos.z >= MAP_MAX_LAYERS) {
 		return;
@@ -138,12 +138,7 @@ void Combat::getCombatArea(const Position& centerPos, const Position& targetPos,
 	if (area) {
 		area->getList(centerPos, targetPos, list);
 	} else {
-		Tile* tile = g_game.getTile(targetPos.x, targetPos.y, targetPos.z);
-		if (!tile) {
-			tile = new StaticTile(targetPos.x, targetPos.y, targetPos.z);
-			g_game.setTile(tile);
-		}
-		list.push_back(tile);
+		list.push_back(targetPos);
 	}
 }
 
@@ -292,6 +287,24 @@ ReturnValue Combat::canDoCombat(Creature* caster, Tile* tile, bool isAggressive)
 		return RETURNVALUE_NOTPOSSIBLE;
 	}
 
+	ReturnValue ret = canDoCombat(caster, tile, tile->getPosition(), isAggressive);
+	if (ret != RETURNVALUE_NOERROR) {
+		return ret;
+	}
+
+	if (caster) {
+		if (const Player* player = caster->getPlayer()) {
+			if (player->hasFlag(PlayerFlag_IgnoreProtectionZone)) {
+				return RETURNVALUE_NOERROR;
+			}
+		}
+	}
+
+	return g_events->eventCreatureOnAreaCombat(caster, tile, isAggressive);
+}
+
+ReturnValue Combat::canDoCombat(const Creature* caster, const Tile* tile, const Position& tilePosition, bool isAggressive)
+{
 	if (tile->hasProperty(CONST_PROP_BLOCKPROJECTILE)) {
 		return RETURNVALUE_NOTENOUGHROOM;
 	}
@@ -306,7 +319,6 @@ ReturnValue Combat::canDoCombat(Creature* caster, Tile* tile, bool isAggressive)
 
 	if (caster) {
 		const Position& casterPosition = caster->getPosition();
-		const Position& tilePosition = tile->getPosition();
 		if (casterPosition.z < tilePosition.z) {
 			return RETURNVALUE_FIRSTGODOWNSTAIRS;
 		} else if (casterPosition.z > tilePosition.z) {
@@ -325,7 +337,7 @@ ReturnValue Combat::canDoCombat(Creature* caster, Tile* tile, bool isAggressive)
 		return RETURNVALUE_ACTIONNOTPERMITTEDINPROTECTIONZONE;
 	}
 
-	return g_events->eventCreatureOnAreaCombat(caster, tile, isAggressive);
+	return RETURNVALUE_NOERROR;
 }
 
 bool Combat::isInPvpZone(const Creature* attacker, const Creature* target)
@@ -757,12 +769,12 @@ void Combat::addDistanceEffect(Creature* caster, const Position& fromPos, const
 
 void Combat::CombatFunc(Creature* caster, const Position& pos, const AreaCombat* area, const CombatParams& params, COMBATFUNC func, void* data)
 {
-	std::list<Tile*> tileList;
+	std::list<Position> positionList;
 
 	if (caster) {
-		getCombatArea(caster->getPosition(), pos, area, tileList);
+		getCombatArea(caster->getPosition(), pos, area, positionList);
 	} else {
-		getCombatArea(pos, pos, area, tileList);
+		getCombatArea(pos, pos, area, positionList);
 	}
 
 	SpectatorVec list;
@@ -771,9 +783,7 @@ void Combat::CombatFunc(Creature* caster, const Position& pos, const AreaCombat*
 	uint32_t diff;
 
 	//calculate the max viewable range
-	for (Tile* tile : tileList) {
-		const Position& tilePos = tile->getPosition();
-
+	for (const Position& tilePos : positionList) {
 		diff = Position::getDistanceX(tilePos, pos);
 		if (diff > maxX) {
 			maxX = diff;
@@ -789,40 +799,75 @@ void Combat::CombatFunc(Creature* caster, const Position& pos, const AreaCombat*
 	const int32_t rangeY = maxY + Map::maxViewportY;
 	g_game.getSpectators(list, pos, true, true, rangeX, rangeX, rangeY, rangeY);
 
-	for (Tile* tile : tileList) {
+	// tiles are only taken for writing, which unshares a shared tile, when
+	// the combat leaves an item on them or hands them to a script
+	const bool changesTiles = params.itemId != 0 || params.tileCallback || g_events->hasCreatureOnAreaCombat() ||
+	                          (caster && caster->hasEventRegistered(CREATURE_EVENT_COMBATAREA));
+
+	for (const Position& tilePos : positionList) {
+		if (!changesTiles) {
+			// a shared tile holds no creatures, so only the effect is left
+			const Tile* tile = g_game.peekTile(tilePos.x, tilePos.y, tilePos.z);
+			if (tile) {
+				if (canDoCombat(caster, tile, tilePos, params.isAggressive) != RETURNVALUE_NOERROR) {
+					continue;
+				}
+				combatTileCreatures(caster, tile, params, func, data);
+			}
+
+			if (params.impactEffect != CONST_ME_NONE) {
+				Game::addMagicEffect(list, tilePos, params.impactEffect);
+			}
+			continue;
+		}
+
+		Tile* tile = g_game.getTile(tilePos);
+		if (!tile) {
+			tile = new StaticTile(tilePos.x, tilePos.y, tilePos.z);
+			g_game.setTile(tile);
+		}
+
 		if (canDoCombat(caster, tile, params.isAggressive) != RETURNVALUE_NOERROR) {
 			continue;
 		}
 
-		if (CreatureVector* creatures = tile->getCreatures()) {
-			const Creature* topCreature = tile->getTopCreature();
-			for (Creature* creature : *creatures) {
-				if (params.targetCasterOrTopMost) {
-					if (caster && caster->getTile() == tile) {
-						if (creature != caster) {
-							continue;
-						}
-					} else if (creature != topCreature) {
-						continue;
-					}
+		combatTileCreatures(caster, tile, params, func, data);
+		combatTileEffects(list, caster, tile, params);
+	}
+	postCombatEffects(caster, pos, params);
+}
+
+void Combat::combatTileCreatures(Creature* caster, const Tile* tile, const CombatParams& params, COMBATFUNC func, void* data)
+{
+	const CreatureVector* creatures = tile->getCreatures();
+	if (!creatures) {
+		return;
+	}
+
+	const Creature* topCreature = tile->getTopCreature();
+	for (Creature* creature : *creatures) {
+		if (params.targetCasterOrTopMost) {
+			if (caster && caster->getTile() == tile) {
+				if (creature != caster) {
+					continue;
 				}
+			} else if (creature != topCreature) {
+				continue;
+			}
+		}
 
-				if (!params.isAggressive || (caster != creature && Combat::canDoCombat(caster, creature, params.isAggressive) == RETURNVALUE_NOERROR)) {
+		if (!params.isAggressive || (caster != creature && Combat::canDoCombat(caster, creature, params.isAggressive) == RETURNVALUE_NOERROR)) {
 
-					func(caster, creature, params, data);
-					if (params.targetCallback) {
-						params.targetCallback->onTargetCombat(caster, creature);
-					}
+			func(caster, creature, params, data);
+			if (params.targetCallback) {
+				params.targetCallback->onTargetCombat(caster, creature);
+			}
 
-					if (params.targetCasterOrTopMost) {
-						break;
-					}
-				}
+			if (params.targetCasterOrTopMost) {
+				break;
 			}
 		}
-		combatTileEffects(list, caster, tile, params);
 	}
-	postCombatEffects(caster, pos, params);
 }
 
 void Combat::doCombat(Creature* caster, Creature* target) const
@@ -1160,7 +1205,7 @@ AreaCombat::AreaCombat(const AreaCombat& rhs)
 	}
 }
 
-void AreaCombat::getList(const Position& centerPos, const Position& targetPos, std::list<Tile*>& list) const
+void AreaCombat::getList(const Position& centerPos, const Position& targetPos, std::list<Position>& list) const
 {
 	const MatrixArea* area = getArea(centerPos, targetPos);
 	if (!area) {
@@ -1176,12 +1221,7 @@ void AreaCombat::getList(const Position& centerPos, const Position& targetPos, s
 		for (uint32_t x = 0; x < cols; ++x) {
 			if (area->getValue(y, x) != 0) {
 				if (g_game.isSightClear(targetPos, tmpPos, true)) {
-					Tile* tile = g_game.getTile(tmpPos);
-					if (!tile) {
-						tile = new StaticTile(tmpPos.x, tmpPos.y, tmpPos.z);
-						g_game.setTile(tile);
-					}
-					list.push_back(tile);
+					list.push_back(tmpPos);
 				}
 			}
 			tmpPos.x++;
@@ -207,7 +207,7 @@ class AreaCombat
 		AreaCombat(const AreaCombat& rhs);
 
 		ReturnValue doCombat(Creature* attacker, const Position& pos, const Combat& combat) const;
-		void getList(const Position& centerPos, const Position& targetPos, std::list<Tile*>& list) const;
+		void getList(const Position& centerPos, const Position& targetPos, std::list<Position>& list) const;
 
 		void setupArea(const std::list<uint32_t>& list, uint32_t rows);
 		void setupArea(int32_t length, int32_t spread);
@@ -284,7 +284,7 @@ class Combat
 		static void doCombatDispel(Creature* caster, Creature* target, const CombatParams& params);
 		static void doCombatDispel(Creature* caster, const Position& position, const AreaCombat* area, const CombatParams& params);
 
-		static void getCombatArea(const Position& centerPos, const Position& targetPos, const AreaCombat* area, std::list<Tile*>& list);
+		static void getCombatArea(const Position& centerPos, const Position& targetPos, const AreaCombat* area, std::list<Position>& list);
 
 		static bool isInPvpZone(const Creature* attacker, const Creature* target);
 		static bool isProtected(const Player* attacker, const Player* target);
@@ -294,6 +294,7 @@ class Combat
 
 		static ReturnValue canTargetCreature(Player* attacker, Creature* target);
 		static ReturnValue canDoCombat(Creature* caster, Tile* tile, bool isAggressive);
+		static ReturnValue canDoCombat(const Creature* caster, const Tile* tile, const Position& tilePosition, bool isAggressive);
 		static ReturnValue canDoCombat(Creature* attacker, Creature* target, bool isAggressive);
 
 		static void postCombatEffects(Creature* caster, const Position& pos, const CombatParams& params);
@@ -339,6 +340,7 @@ class Combat
 		static bool CombatnullptrFunc(Creature* caster, Creature* target, const CombatParams& params, void* data);
 
 		static void combatTileEffects(const SpectatorVec& list, Creature* caster, Tile* tile, const CombatParams& params);
+		static void combatTileCreatures(Creature* caster, const Tile* tile, const CombatParams& params, COMBATFUNC func, void* data);
 		CombatDamage getCombatDamage(Creature* creature, Creature* target) const;
 
 		//configureable
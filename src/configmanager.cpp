@@ -60,6 +60,7 @@ bool ConfigManager::load()
 	if (!m_isLoaded) { //info that must be loaded one time (unless we reset the modules involved)
 		m_confBoolean[BIND_ONLY_GLOBAL_ADDRESS] = booleanString(getGlobalString(L, "bindOnlyGlobalAddress", "no"));
 		m_confBoolean[OPTIMIZE_DATABASE] = booleanString(getGlobalString(L, "startupDatabaseOptimization", "yes"));
+		m_confBoolean[NETWORK_REUSE_PORT] = booleanString(getGlobalString(L, "networkReusePort", "no"));
 
 		m_confString[IP] = getGlobalString(L, "ip", "127.0.0.1");
 		m_confString[MAP_NAME] = getGlobalString(L, "mapName", "forgotten");
@@ -75,6 +76,7 @@ bool ConfigManager::load()
 		m_confNumber[GAME_PORT] = getGlobalNumber(L, "gameProtocolPort", 7172);
 		m_confNumber[LOGIN_PORT] = getGlobalNumber(L, "loginProtocolPort", 7171);
 		m_confNumber[STATUS_PORT] = getGlobalNumber(L, "statusProtocolPort", 7171);
+		m_confNumber[NETWORK_THREADS] = getGlobalNumber(L, "networkThreads", 1);
 
 		m_confNumber[MARKET_OFFER_DURATION] = getGlobalNumber(L, "marketOfferDuration", 30 * 24 * 60 * 60);
 	}
@@ -95,6 +97,7 @@ bool ConfigManager::load()
 	m_confBoolean[WARN_UNSAFE_SCRIPTS] = booleanString(getGlobalString(L, "warnUnsafeScripts", "no"));
 	m_confBoolean[CONVERT_UNSAFE_SCRIPTS] = booleanString(getGlobalString(L, "convertUnsafeScripts", "no"));
 	m_confBoolean[CLASSIC_EQUIPMENT_SLOTS] = booleanString(getGlobalString(L, "classicEquipmentSlots", "no"));
+	m_confBoolean[OUTPUT_FLUSH_FRAME] = getGlobalString(L, "outputFlushPolicy", "threshold") == "frame";
 
 	m_confString[DEFAULT_PRIORITY] = getGlobalString(L, "defaultPriority", "high");
 	m_confString[SERVER_NAME] = getGlobalString(L, "serverName");
@@ -131,6 +134,8 @@ bool ConfigManager::load()
 	m_confNumber[CHECK_EXPIRED_MARKET_OFFERS_EACH_MINUTES] = getGlobalNumber(L, "checkExpiredMarketOffersEachMinutes", 60);
 	m_confNumber[MAX_MARKET_OFFERS_AT_A_TIME_PER_PLAYER] = getGlobalNumber(L, "maxMarketOffersAtATimePerPlayer", 100);
 	m_confNumber[MAX_PACKETS_PER_SECOND] = getGlobalNumber(L, "maxPacketsPerSecond", 25);
+	m_confNumber[OUTPUT_FLUSH_THRESHOLD] = getGlobalNumber(L, "outputFlushThreshold", 8192);
+	m_confNumber[MAX_QUEUED_OUTPUT_BYTES] = getGlobalNumber(L, "maxQueuedOutputBytes", 0);
 
 	m_isLoaded = true;
 	lua_close(L);
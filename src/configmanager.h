@@ -47,6 +47,8 @@ class ConfigManager
 			WARN_UNSAFE_SCRIPTS = 15,
 			CONVERT_UNSAFE_SCRIPTS = 16,
 			CLASSIC_EQUIPMENT_SLOTS = 17,
+			NETWORK_REUSE_PORT = 18,
+			OUTPUT_FLUSH_FRAME = 19,
 			LAST_BOOLEAN_CONFIG /* this must be the last one */
 		};
 
@@ -104,6 +106,9 @@ class ConfigManager
 			MAX_MARKET_OFFERS_AT_A_TIME_PER_PLAYER = 28,
 			EXP_FROM_PLAYERS_LEVEL_RANGE = 29,
 			MAX_PACKETS_PER_SECOND = 30,
+			OUTPUT_FLUSH_THRESHOLD = 31,
+			NETWORK_THREADS = 32,
+			MAX_QUEUED_OUTPUT_BYTES = 33,
 			LAST_NUMBER_CONFIG /* this must be the last one */
 		};
 
@@ -99,6 +99,8 @@ void Connection::closeConnectionTask()
 	m_connectionState = CONNECTION_STATE_CLOSING;
 
 	if (m_pendingWrite == 0 || m_writeError) {
+		m_messageQueue.clear();
+		m_queuedBytes = 0;
 		closeSocket();
 		releaseConnection();
 		m_connectionState = CONNECTION_STATE_CLOSED;
@@ -344,28 +346,129 @@ bool Connection::send(OutputMessage_ptr msg)
 		return false;
 	}
 
-	if (m_pendingWrite == 0) {
-		msg->getProtocol()->onSendMessage(msg);
-		internalSend(msg);
-	} else {
-		OutputMessagePool::getInstance()->addToAutoSend(msg);
+	const size_t maxQueuedBytes = g_config.getNumber(ConfigManager::MAX_QUEUED_OUTPUT_BYTES);
+	if (maxQueuedBytes != 0 && m_queuedBytes + msg->getMessageLength() > maxQueuedBytes) {
+		// the client does not keep up with its writes, drop what is still
+		// waiting instead of holding on to it until the write timeout
+		std::cout << convertIPToString(getIP()) << " disconnected for exceeding the output queue limit." << std::endl;
+		m_messageQueue.clear();
+		m_queuedBytes = 0;
+		closeConnection();
+		m_connectionLock.unlock();
+		return false;
 	}
 
+	msg->getProtocol()->onSendMessage(msg);
+	m_messageQueue.push_back(msg);
+	m_queuedBytes += msg->getMessageLength();
+
 	m_connectionLock.unlock();
 	return true;
 }
 
-void Connection::internalSend(OutputMessage_ptr msg)
+void Connection::flush()
+{
+	m_connectionLock.lock();
+
+	if (m_writeError || m_connectionState == CONNECTION_STATE_CLOSED) {
+		m_messageQueue.clear();
+		m_queuedBytes = 0;
+	} else if (m_pendingWrite == 0 && !m_messageQueue.empty() && m_connectionState != CONNECTION_STATE_CLOSING) {
+		// the write is started (and the messages encrypted) on a network
+		// thread, keeping that work out of the dispatcher. Messages queued
+		// before closeConnection() still go out, the socket is closed once
+		// they have been written
+		++m_pendingWrite;
+		m_io_service.post(std::bind(&Connection::onFlushOperation, shared_from_this()));
+	}
+
+	m_connectionLock.unlock();
+}
+
+void Connection::onFlushOperation()
 {
+	//io_service thread
+	m_connectionLock.lock();
+
+	if (m_connectionState == CONNECTION_STATE_CLOSED) {
+		m_connectionLock.unlock();
+		return;
+	}
+
+	if (!m_socket->is_open()) {
+		// closed by a timeout while the flush was queued
+		m_writeError = true;
+	}
+
+	if (m_writeError) {
+		closeAfterWriteError();
+		m_connectionLock.unlock();
+		return;
+	}
+
+	--m_pendingWrite;
+	onWriteCompleted();
+
+	m_connectionLock.unlock();
+}
+
+void Connection::onWriteCompleted()
+{
+	if (!m_messageQueue.empty()) {
+		internalSend();
+	} else if (m_connectionState == CONNECTION_STATE_CLOSING && m_pendingWrite == 0) {
+		// closeConnectionTask left the socket open for this write
+		closeAfterWrites();
+	}
+}
+
+void Connection::closeAfterWriteError()
+{
+	m_messageQueue.clear();
+	m_queuedBytes = 0;
+
+	if (m_connectionState == CONNECTION_STATE_CLOSING) {
+		closeAfterWrites();
+	} else {
+		closeSocket();
+		closeConnection();
+	}
+}
+
+void Connection::closeAfterWrites()
+{
+	//io_service thread
+	// closeConnection() does nothing once closeConnectionTask has run, the
+	// reference count is only looked at on the dispatcher thread
+	closeSocket();
+	m_connectionState = CONNECTION_STATE_CLOSED;
+
+	g_dispatcher.addTask(
+	    createTask(std::bind(&Connection::releaseConnection, this)));
+}
+
+void Connection::internalSend()
+{
+	//io_service thread
+	// everything queued so far goes out in one scatter/gather write, messages
+	// queued while it is in progress are picked up by onWriteOperation
+	m_writeQueue.swap(m_messageQueue);
+	m_queuedBytes = 0;
+
+	m_writeBuffers.clear();
+	for (const OutputMessage_ptr& msg : m_writeQueue) {
+		msg->getProtocol()->prepareMessage(*msg);
+		m_writeBuffers.emplace_back(msg->getOutputBuffer(), msg->getMessageLength());
+	}
+
 	try {
 		++m_pendingWrite;
 		m_writeTimer.expires_from_now(boost::posix_time::seconds(Connection::write_timeout));
 		m_writeTimer.async_wait( std::bind(&Connection::handleWriteTimeout, std::weak_ptr<Connection>(shared_from_this()),
 		                                     std::placeholders::_1));
 
-		boost::asio::async_write(getHandle(),
-		                         boost::asio::buffer(msg->getOutputBuffer(), msg->getMessageLength()),
-		                         std::bind(&Connection::onWriteOperation, shared_from_this(), msg, std::placeholders::_1));
+		boost::asio::async_write(getHandle(), m_writeBuffers,
+		                         std::bind(&Connection::onWriteOperation, shared_from_this(), std::placeholders::_1));
 	} catch (boost::system::system_error& e) {
 		if (m_logError) {
 			std::cout << "[Network error - Connection::internalSend] " << e.what() << std::endl;
@@ -387,25 +490,31 @@ uint32_t Connection::getIP() const
 	return htonl(endpoint.address().to_v4().to_ulong());
 }
 
-void Connection::onWriteOperation(OutputMessage_ptr msg, const boost::system::error_code& error)
+void Connection::onWriteOperation(const boost::system::error_code& error)
 {
 	m_connectionLock.lock();
 	m_writeTimer.cancel();
 
-	msg.reset();
+	m_writeQueue.clear();
 
 	if (error) {
 		handleWriteError(error);
 	}
 
-	if (m_connectionState != CONNECTION_STATE_OPEN || m_writeError) {
-		closeSocket();
-		closeConnection();
+	if (m_connectionState == CONNECTION_STATE_CLOSED) {
+		m_connectionLock.unlock();
+		return;
+	}
+
+	if (m_writeError) {
+		closeAfterWriteError();
 		m_connectionLock.unlock();
 		return;
 	}
 
 	--m_pendingWrite;
+	onWriteCompleted();
+
 	m_connectionLock.unlock();
 }
 
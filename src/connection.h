@@ -20,6 +20,7 @@
 #ifndef FS_CONNECTION_H_FC8E1B4392D24D27A2F129D8B93A6348
 #define FS_CONNECTION_H_FC8E1B4392D24D27A2F129D8B93A6348
 
+#include <atomic>
 #include <unordered_set>
 
 #include "networkmessage.h"
@@ -84,6 +85,7 @@ class Connection : public std::enable_shared_from_this<Connection>
 			m_protocol = nullptr;
 			m_pendingWrite = 0;
 			m_pendingRead = 0;
+			m_queuedBytes = 0;
 			m_connectionState = CONNECTION_STATE_OPEN;
 			m_receivedFirst = false;
 			m_writeError = false;
@@ -103,7 +105,10 @@ class Connection : public std::enable_shared_from_this<Connection>
 		void acceptConnection(Protocol* protocol);
 		void acceptConnection();
 
+		// Queues a message, the queue is encrypted and written with a single
+		// gathered write on a network thread once flush() is called
 		bool send(OutputMessage_ptr msg);
+		void flush();
 
 		uint32_t getIP() const;
 
@@ -118,7 +123,11 @@ class Connection : public std::enable_shared_from_this<Connection>
 		void parseHeader(const boost::system::error_code& error);
 		void parsePacket(const boost::system::error_code& error);
 
-		void onWriteOperation(OutputMessage_ptr msg, const boost::system::error_code& error);
+		void onFlushOperation();
+		void onWriteOperation(const boost::system::error_code& error);
+		void onWriteCompleted();
+		void closeAfterWriteError();
+		void closeAfterWrites();
 
 		void onStopOperation();
 		void handleReadError(const boost::system::error_code& error);
@@ -134,10 +143,16 @@ class Connection : public std::enable_shared_from_this<Connection>
 		void onReadTimeout();
 		void onWriteTimeout();
 
-		void internalSend(OutputMessage_ptr msg);
+		void internalSend();
 
 		NetworkMessage m_msg;
 
+		// messages waiting for the next write and the ones being written
+		std::vector<OutputMessage_ptr> m_messageQueue;
+		size_t m_queuedBytes;
+		std::vector<OutputMessage_ptr> m_writeQueue;
+		std::vector<boost::asio::const_buffer> m_writeBuffers;
+
 		boost::asio::deadline_timer m_readTimer;
 		boost::asio::deadline_timer m_writeTimer;
 
@@ -151,7 +166,9 @@ class Connection : public std::enable_shared_from_this<Connection>
 
 		time_t m_timeConnected;
 		uint32_t m_packetsSent;
-		uint32_t m_refCount;
+		// output messages referencing this connection, taken on network
+		// threads and released on the dispatcher
+		std::atomic<uint32_t> m_refCount;
 		int32_t m_pendingWrite;
 		int32_t m_pendingRead;
 		ConnectionState_t m_connectionState;
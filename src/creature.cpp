@@ -349,7 +349,7 @@ void Creature::stopEventWalk()
 
 void Creature::updateMapCache()
 {
-	Tile* tile;
+	const Tile* tile;
 	const Position& myPos = getPosition();
 	Position pos(0, 0, myPos.z);
 
@@ -357,7 +357,7 @@ void Creature::updateMapCache()
 		for (int32_t x = -maxWalkCacheWidth; x <= maxWalkCacheWidth; ++x) {
 			pos.x = myPos.getX() + x;
 			pos.y = myPos.getY() + y;
-			tile = g_game.getTile(pos.x, pos.y, myPos.z);
+			tile = g_game.peekTile(pos.x, pos.y, myPos.z);
 			updateTileCache(tile, pos);
 		}
 	}
@@ -547,7 +547,7 @@ void Creature::onCreatureMove(Creature* creature, const Tile* newTile, const Pos
 			if (teleport || oldPos.z != newPos.z) {
 				updateMapCache();
 			} else {
-				Tile* tile;
+				const Tile* tile;
 				const Position& myPos = getPosition();
 				Position pos;
 
@@ -559,7 +559,7 @@ void Creature::onCreatureMove(Creature* creature, const Tile* newTile, const Pos
 
 					//update 0
 					for (int32_t x = -maxWalkCacheWidth; x <= maxWalkCacheWidth; ++x) {
-						tile = g_game.getTile(myPos.getX() + x, myPos.getY() - maxWalkCacheHeight, myPos.z);
+						tile = g_game.peekTile(myPos.getX() + x, myPos.getY() - maxWalkCacheHeight, myPos.z);
 						updateTileCache(tile, x, -maxWalkCacheHeight);
 					}
 				} else if (oldPos.y < newPos.y) { // south
@@ -570,7 +570,7 @@ void Creature::onCreatureMove(Creature* creature, const Tile* newTile, const Pos
 
 					//update mapWalkHeight - 1
 					for (int32_t x = -maxWalkCacheWidth; x <= maxWalkCacheWidth; ++x) {
-						tile = g_game.getTile(myPos.getX() + x, myPos.getY() + maxWalkCacheHeight, myPos.z);
+						tile = g_game.peekTile(myPos.getX() + x, myPos.getY() + maxWalkCacheHeight, myPos.z);
 						updateTileCache(tile, x, maxWalkCacheHeight);
 					}
 				}
@@ -595,7 +595,7 @@ void Creature::onCreatureMove(Creature* creature, const Tile* newTile, const Pos
 
 					//update mapWalkWidth - 1
 					for (int32_t y = -maxWalkCacheHeight; y <= maxWalkCacheHeight; ++y) {
-						tile = g_game.getTile(myPos.x + maxWalkCacheWidth, myPos.y + y, myPos.z);
+						tile = g_game.peekTile(myPos.x + maxWalkCacheWidth, myPos.y + y, myPos.z);
 						updateTileCache(tile, maxWalkCacheWidth, y);
 					}
 				} else if (oldPos.x > newPos.x) { // west
@@ -618,7 +618,7 @@ void Creature::onCreatureMove(Creature* creature, const Tile* newTile, const Pos
 
 					//update 0
 					for (int32_t y = -maxWalkCacheHeight; y <= maxWalkCacheHeight; ++y) {
-						tile = g_game.getTile(myPos.x - maxWalkCacheWidth, myPos.y + y, myPos.z);
+						tile = g_game.peekTile(myPos.x - maxWalkCacheWidth, myPos.y + y, myPos.z);
 						updateTileCache(tile, -maxWalkCacheWidth, y);
 					}
 				}
@@ -972,7 +972,12 @@ void Creature::goToFollowCreature()
 			}
 		} else {
 			listWalkDir.clear();
-			if (getPathTo(followCreature->getPosition(), listWalkDir, fpp)) {
+
+			// monsters closing in for melee share one flow field per target
+			bool flowFieldPath = monster && fpp.minTargetDist == 1 && fpp.maxTargetDist == 1 && fpp.fullPathSearch &&
+			                     fpp.allowDiagonal && !fpp.keepDistance &&
+			                     g_game.getMap()->getFlowFieldPath(*this, *followCreature, listWalkDir);
+			if (flowFieldPath || getPathTo(followCreature->getPosition(), listWalkDir, fpp)) {
 				hasFollowPath = true;
 				startAutoWalk(listWalkDir);
 			} else {
@@ -1650,7 +1655,16 @@ bool Creature::isInvisible() const
 
 bool Creature::getPathTo(const Position& targetPos, std::list<Direction>& dirList, const FindPathParams& fpp) const
 {
-	return g_game.getMap()->getPathMatching(*this, dirList, FrozenPathingConditionCall(targetPos), fpp);
+	Map* map = g_game.getMap();
+
+	// an unbounded search that far out would run out of nodes first
+	const Position& pos = getPosition();
+	if (fpp.maxSearchDist == 0 && (Position::getDistanceX(pos, targetPos) > SECTOR_SIZE || Position::getDistanceY(pos, targetPos) > SECTOR_SIZE)) {
+		if (map->getSectorPath(*this, targetPos, dirList, fpp)) {
+			return true;
+		}
+	}
+	return map->getPathMatching(*this, dirList, FrozenPathingConditionCall(targetPos), fpp);
 }
 
 bool Creature::getPathTo(const Position& targetPos, std::list<Direction>& dirList, int32_t minTargetDist, int32_t maxTargetDist, bool fullPathSearch /*= true*/, bool clearSight /*= true*/, int32_t maxSearchDist /*= 0*/) const
@@ -50,7 +50,8 @@ enum itemAttrTypes {
 	ITEM_ATTRIBUTE_CORPSEOWNER = 524288,
 	ITEM_ATTRIBUTE_CHARGES = 1048576,
 	ITEM_ATTRIBUTE_FLUIDTYPE = 2097152,
-	ITEM_ATTRIBUTE_DOORID = 4194304
+	ITEM_ATTRIBUTE_DOORID = 4194304,
+	ITEM_ATTRIBUTE_DURATION_TIMESTAMP = 8388608
 };
 
 enum VipStatus_t : uint8_t {
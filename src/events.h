@@ -39,6 +39,9 @@ class Events
 		bool eventCreatureOnChangeOutfit(Creature* creature, const Outfit_t& outfit);
 		ReturnValue eventCreatureOnAreaCombat(Creature* creature, Tile* tile, bool isAggressive);
 		ReturnValue eventCreatureOnTargetCombat(Creature* creature, Creature* target);
+		bool hasCreatureOnAreaCombat() const {
+			return creatureOnAreaCombat != -1;
+		}
 
 		// Party
 		bool eventPartyOnJoin(Party* party, Player* player);
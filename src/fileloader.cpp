@@ -21,215 +21,320 @@
 
 #include "fileloader.h"
 
-FileLoader::FileLoader() : m_cached_data()
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+FileLoader::FileLoader()
 {
-	m_file = nullptr;
+	m_data = nullptr;
+	m_end = nullptr;
 	m_root = nullptr;
-	m_buffer = new uint8_t[1024];
-	m_buffer_size = 1024;
 	m_lastError = ERROR_NONE;
-
-	//cache
-	m_cache_size = 0;
-	m_cache_index = NO_VALID_CACHE;
-	m_cache_offset = NO_VALID_CACHE;
+	m_threads = 1;
 }
 
 FileLoader::~FileLoader()
 {
-	if (m_file) {
-		fclose(m_file);
-		m_file = nullptr;
-	}
-
-	NodeStruct::clearNet(m_root);
-	delete[] m_buffer;
-
-	for (int32_t i = 0; i < CACHE_BLOCKS; i++) {
-		delete[] m_cached_data[i].data;
-	}
+	// nodes are owned by m_pools and only point into the mapping
 }
 
-bool FileLoader::openFile(const char* filename, const char* accept_identifier)
+bool FileLoader::openFile(const char* filename, const char* accept_identifier, uint32_t threads /*= 0*/)
 {
-	m_file = fopen(filename, "rb");
-	if (!m_file) {
+	try {
+		boost::interprocess::file_mapping mapping(filename, boost::interprocess::read_only);
+		m_region.reset(new boost::interprocess::mapped_region(mapping, boost::interprocess::read_only));
+	} catch (const boost::interprocess::interprocess_exception&) {
 		m_lastError = ERROR_CAN_NOT_OPEN;
 		return false;
 	}
 
-	char identifier[4];
-	if (fread(identifier, 1, 4, m_file) < 4) {
-		fclose(m_file);
-		m_file = nullptr;
+	m_data = static_cast<const uint8_t*>(m_region->get_address());
+	m_end = m_data + m_region->get_size();
+
+	if (m_region->get_size() < 4) {
 		m_lastError = ERROR_EOF;
 		return false;
 	}
 
 	// The first four bytes must either match the accept identifier or be 0x00000000 (wildcard)
-	if (memcmp(identifier, accept_identifier, 4) != 0 && memcmp(identifier, "\0\0\0\0", 4) != 0) {
-		fclose(m_file);
-		m_file = nullptr;
+	if (memcmp(m_data, accept_identifier, 4) != 0 && memcmp(m_data, "\0\0\0\0", 4) != 0) {
 		m_lastError = ERROR_INVALID_FILE_VERSION;
 		return false;
 	}
 
-	fseek(m_file, 0, SEEK_END);
-	int32_t file_size = ftell(m_file);
-	m_cache_size = std::min<uint32_t>(32768, std::max<uint32_t>(file_size / 20, 8192)) & ~0x1FFF;
-
-	if (!safeSeek(4)) {
+	if (m_end - m_data < 5 || m_data[4] != NODE_START) {
 		m_lastError = ERROR_INVALID_FORMAT;
 		return false;
 	}
 
-	delete m_root;
-	m_root = new NodeStruct();
-	m_root->start = 4;
+	if (threads == 0) {
+		// indexing scans the file twice, it only pays off with enough cores
+		threads = std::thread::hardware_concurrency();
+		if (threads < FILELOADER_MIN_AUTO_THREADS) {
+			threads = 1;
+		}
+	}
+	m_threads = std::max<uint32_t>(1, threads);
+
+	if (m_threads > 1) {
+		DeferredNodes deferred;
+		if (indexNodes(deferred.ranges) && parseRoot(&deferred) && parseDeferred(deferred)) {
+			return true;
+		}
 
-	int32_t byte;
-	if (safeSeek(4) && readByte(byte) && byte == NODE_START) {
-		return parseNode(m_root);
+		// the index is only a guess for files with unusual node types,
+		// parse them again the safe way
+		m_threads = 1;
 	}
 
-	return false;
+	if (!parseRoot(nullptr)) {
+		m_lastError = ERROR_INVALID_FORMAT;
+		return false;
+	}
+	return true;
 }
 
-bool FileLoader::parseNode(NODE node)
+bool FileLoader::parseRoot(DeferredNodes* deferred)
 {
-	int32_t byte, pos;
-	NODE currentNode = node;
+	// one pool per thread, the first is also used for the nodes above
+	// FILELOADER_PARALLEL_DEPTH, those are parsed before any worker starts
+	m_pools.clear();
+	m_pools.resize(m_threads);
 
-	while (readByte(byte)) {
-		currentNode->type = byte;
-		bool setPropsSize = false;
+	m_pools[0].emplace_back();
+	m_root = &m_pools[0].back();
 
-		while (true) {
-			if (!readByte(byte)) {
+	const uint8_t* pos = m_data + 5;
+	return parseNode(m_root, pos, 0, m_pools[0], deferred);
+}
+
+bool FileLoader::parseNode(NODE node, const uint8_t*& pos, uint32_t depth, NodePool& pool, DeferredNodes* deferred)
+{
+	if (pos >= m_end) {
+		return false;
+	}
+
+	node->type = *pos++;
+	node->props = pos;
+
+	// the three special bytes are the three highest values
+	while (pos < m_end) {
+		if (*pos < ESCAPE_CHAR) {
+			++pos;
+		} else if (*pos == ESCAPE_CHAR) {
+			node->escaped = true;
+			pos += 2;
+		} else {
+			break;
+		}
+	}
+
+	if (pos >= m_end) {
+		return false;
+	}
+
+	node->propsSize = pos - node->props;
+
+	NODE* link = &node->child;
+	while (*pos == NODE_START) {
+		++pos;
+
+		pool.emplace_back();
+		NODE child = &pool.back();
+		*link = child;
+		link = &child->next;
+
+		if (deferred && depth + 1 == FILELOADER_PARALLEL_DEPTH) {
+			// only remember where it starts, parseDeferred fills it in
+			size_t index = deferred->nodes.size();
+			if (index >= deferred->ranges.size() || deferred->ranges[index].first != pos) {
 				return false;
 			}
 
-			bool skipNode = false;
+			child->props = pos;
+			deferred->nodes.push_back(child);
+			pos = deferred->ranges[index].second;
+		} else if (!parseNode(child, pos, depth + 1, pool, deferred)) {
+			return false;
+		}
+
+		if (pos >= m_end) {
+			return false;
+		}
+	}
+
+	if (*pos != NODE_END) {
+		return false;
+	}
 
-			switch (byte) {
-				case NODE_START: {
-					//child node start
-					if (!safeTell(pos)) {
-						return false;
-					}
+	++pos;
+	return true;
+}
 
-					NODE childNode = new NodeStruct();
-					childNode->start = pos;
-					currentNode->propsSize = pos - currentNode->start - 2;
-					currentNode->child = childNode;
+int32_t FileLoader::scanChunk(const uint8_t* pos, const uint8_t* last, int32_t depth, NodeRanges* ranges) const
+{
+	// a special byte is escaped if an odd number of escape chars precede it
+	const uint8_t* escapes = pos;
+	while (escapes > m_data + 4 && escapes[-1] == ESCAPE_CHAR) {
+		--escapes;
+	}
 
-					setPropsSize = true;
+	if (((pos - escapes) & 1) != 0) {
+		++pos;
+	}
 
-					if (!parseNode(childNode)) {
-						return false;
-					}
+	while (pos < last) {
+		switch (*pos) {
+			case ESCAPE_CHAR:
+				pos += 2;
+				break;
 
-					break;
+			case NODE_START:
+				// node types are never special bytes, skip it along
+				pos += 2;
+				if (ranges && depth == FILELOADER_PARALLEL_DEPTH) {
+					ranges->emplace_back(pos - 1, nullptr);
 				}
+				++depth;
+				break;
 
-				case NODE_END: {
-					//current node end
-					if (!setPropsSize) {
-						if (!safeTell(pos)) {
-							return false;
-						}
-
-						currentNode->propsSize = pos - currentNode->start - 2;
-					}
-
-					if (!readByte(byte)) {
-						return true;
-					}
-
-					switch (byte) {
-						case NODE_START: {
-							//starts next node
-							if (!safeTell(pos)) {
-								return false;
-							}
-
-							skipNode = true;
-							NODE nextNode = new NodeStruct();
-							nextNode->start = pos;
-							currentNode->next = nextNode;
-							currentNode = nextNode;
-							break;
-						}
-
-						case NODE_END:
-							return safeTell(pos) && safeSeek(pos);
-
-						default:
-							m_lastError = ERROR_INVALID_FORMAT;
-							return false;
-					}
-
-					break;
+			case NODE_END:
+				++pos;
+				if (--depth == FILELOADER_PARALLEL_DEPTH && ranges) {
+					ranges->emplace_back(nullptr, pos);
 				}
+				break;
 
-				case ESCAPE_CHAR: {
-					if (!readByte(byte)) {
-						return false;
-					}
+			default:
+				++pos;
+				break;
+		}
+	}
+	return depth;
+}
 
-					break;
-				}
+bool FileLoader::indexNodes(NodeRanges& ranges) const
+{
+	const uint8_t* begin = m_data + 4;
+	const size_t size = m_end - begin;
+	const size_t chunks = std::min<size_t>(m_threads, size / 4096 + 1);
+
+	std::vector<int32_t> depths(chunks + 1);
+	std::vector<NodeRanges> found(chunks);
+
+	auto forEachChunk = [&](const std::function<void(size_t, const uint8_t*, const uint8_t*)>& f) {
+		std::vector<std::thread> workers;
+		workers.reserve(chunks - 1);
+		for (size_t i = 1; i < chunks; ++i) {
+			workers.emplace_back(f, i, begin + size * i / chunks, begin + size * (i + 1) / chunks);
+		}
 
-				default:
-					break;
-			}
+		f(0, begin, begin + size / chunks);
 
-			if (skipNode) {
-				break;
+		for (std::thread& worker : workers) {
+			worker.join();
+		}
+	};
+
+	// first the depth change of each chunk, then the node ranges with the
+	// depth every chunk starts at
+	forEachChunk([&](size_t i, const uint8_t* first, const uint8_t* last) {
+		depths[i + 1] = scanChunk(first, last, 0, nullptr);
+	});
+
+	for (size_t i = 1; i <= chunks; ++i) {
+		depths[i] += depths[i - 1];
+	}
+
+	forEachChunk([&](size_t i, const uint8_t* first, const uint8_t* last) {
+		scanChunk(first, last, depths[i], &found[i]);
+	});
+
+	// a range may start and end in different chunks
+	ranges.clear();
+	size_t open = 0;
+	for (const NodeRanges& chunkRanges : found) {
+		for (const NodeRange& range : chunkRanges) {
+			if (range.first) {
+				if (open != ranges.size()) {
+					return false;
+				}
+				ranges.push_back(range);
+			} else {
+				if (open >= ranges.size()) {
+					return false;
+				}
+				ranges[open++].second = range.second;
 			}
 		}
 	}
-	return false;
+	return open == ranges.size();
 }
 
-const uint8_t* FileLoader::getProps(const NODE node, size_t& size)
+bool FileLoader::parseDeferred(const DeferredNodes& deferred)
 {
-	if (!node) {
-		return nullptr;
+	const std::vector<NODE>& nodes = deferred.nodes;
+	if (nodes.size() != deferred.ranges.size()) {
+		return false;
 	}
 
-	if (node->propsSize >= m_buffer_size) {
-		delete[] m_buffer;
+	if (nodes.empty()) {
+		return true;
+	}
 
-		while (node->propsSize >= m_buffer_size) {
-			m_buffer_size *= 2;
+	const size_t threads = std::min<size_t>(m_threads, nodes.size());
+	std::vector<char> results(threads, 1);
+
+	auto parseRange = [&](size_t index) {
+		size_t first = nodes.size() * index / threads;
+		size_t last = nodes.size() * (index + 1) / threads;
+		for (size_t i = first; i < last; ++i) {
+			const uint8_t* pos = nodes[i]->props;
+			if (!parseNode(nodes[i], pos, FILELOADER_PARALLEL_DEPTH, m_pools[index], nullptr) || pos != deferred.ranges[i].second) {
+				results[index] = 0;
+				return;
+			}
 		}
+	};
 
-		m_buffer = new uint8_t[m_buffer_size];
+	std::vector<std::thread> workers;
+	workers.reserve(threads - 1);
+	for (size_t i = 1; i < threads; ++i) {
+		workers.emplace_back(parseRange, i);
 	}
 
-	//get buffer
-	if (!readBytes(m_buffer, node->propsSize, node->start + 2)) {
+	parseRange(0);
+
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+	return std::find(results.begin(), results.end(), 0) == results.end();
+}
+
+const uint8_t* FileLoader::getProps(const NODE node, size_t& size)
+{
+	if (!node) {
 		return nullptr;
 	}
 
-	//unscape buffer
+	if (!node->escaped) {
+		size = node->propsSize;
+		return node->props;
+	}
+
+	//unescape into the shared buffer, valid until the next call
+	m_buffer.resize(node->propsSize);
+
 	size_t j = 0;
-	bool escaped = false;
 	for (uint32_t i = 0; i < node->propsSize; ++i, ++j) {
-		if (m_buffer[i] == ESCAPE_CHAR) {
-			//escape char found, skip it and write next
-			m_buffer[j] = m_buffer[++i];
-			//is neede a displacement for next bytes
-			escaped = true;
-		} else if (escaped) {
-			//perform that displacement
-			m_buffer[j] = m_buffer[i];
+		if (node->props[i] == ESCAPE_CHAR) {
+			++i;
 		}
+		m_buffer[j] = node->props[i];
 	}
 
 	size = j;
-	return m_buffer;
+	return m_buffer.data();
 }
 
 bool FileLoader::getProps(const NODE node, PropStream& props)
@@ -271,148 +376,3 @@ NODE FileLoader::getNextNode(const NODE prev, uint32_t& type)
 	}
 	return next;
 }
-
-inline bool FileLoader::readByte(int32_t& value)
-{
-	if (m_cache_index == NO_VALID_CACHE) {
-		m_lastError = ERROR_CACHE_ERROR;
-		return false;
-	}
-
-	if (m_cache_offset >= m_cached_data[m_cache_index].size) {
-		int32_t pos = m_cache_offset + m_cached_data[m_cache_index].base;
-		int32_t tmp = getCacheBlock(pos);
-		if (tmp < 0) {
-			return false;
-		}
-
-		m_cache_index = tmp;
-		m_cache_offset = pos - m_cached_data[m_cache_index].base;
-		if (m_cache_offset >= m_cached_data[m_cache_index].size) {
-			return false;
-		}
-	}
-
-	value = m_cached_data[m_cache_index].data[m_cache_offset++];
-	return true;
-}
-
-inline bool FileLoader::readBytes(uint8_t* buffer, uint32_t size, int32_t pos)
-{
-	//seek at pos
-	uint32_t reading, remain = size, bufferPos = 0;
-	do {
-		//prepare cache
-		uint32_t i = getCacheBlock(pos);
-		if (i == NO_VALID_CACHE) {
-			return false;
-		}
-
-		m_cache_index = i;
-		m_cache_offset = pos - m_cached_data[i].base;
-
-		//get maximum read block size and calculate remaining bytes
-		reading = std::min<int32_t>(remain, m_cached_data[i].size - m_cache_offset);
-		remain -= reading;
-
-		//read it
-		memcpy(buffer + bufferPos, m_cached_data[m_cache_index].data + m_cache_offset, reading);
-
-		//update variables
-		m_cache_offset += reading;
-		bufferPos += reading;
-		pos += reading;
-	} while (remain > 0);
-	return true;
-}
-
-inline bool FileLoader::safeSeek(uint32_t pos)
-{
-	uint32_t i = getCacheBlock(pos);
-	if (i == NO_VALID_CACHE) {
-		return false;
-	}
-
-	m_cache_index = i;
-	m_cache_offset = pos - m_cached_data[i].base;
-	return true;
-}
-
-inline bool FileLoader::safeTell(int32_t& pos)
-{
-	if (m_cache_index == NO_VALID_CACHE) {
-		m_lastError = ERROR_CACHE_ERROR;
-		return false;
-	}
-
-	pos = m_cached_data[m_cache_index].base + m_cache_offset - 1;
-	return true;
-}
-
-inline uint32_t FileLoader::getCacheBlock(uint32_t pos)
-{
-	bool found = false;
-	uint32_t i, base_pos = pos & ~(m_cache_size - 1);
-
-	for (i = 0; i < CACHE_BLOCKS; i++) {
-		if (m_cached_data[i].loaded) {
-			if (m_cached_data[i].base == base_pos) {
-				found = true;
-				break;
-			}
-		}
-	}
-
-	if (!found) {
-		i = loadCacheBlock(pos);
-	}
-
-	return i;
-}
-
-int32_t FileLoader::loadCacheBlock(uint32_t pos)
-{
-	int32_t i, loading_cache = -1, base_pos = pos & ~(m_cache_size - 1);
-
-	for (i = 0; i < CACHE_BLOCKS; i++) {
-		if (!m_cached_data[i].loaded) {
-			loading_cache = i;
-			break;
-		}
-	}
-
-	if (loading_cache == -1) {
-		for (i = 0; i < CACHE_BLOCKS; i++) {
-			if (abs(static_cast<long>(m_cached_data[i].base) - base_pos) > static_cast<long>(2 * m_cache_size)) {
-				loading_cache = i;
-				break;
-			}
-		}
-
-		if (loading_cache == -1) {
-			loading_cache = 0;
-		}
-	}
-
-	if (m_cached_data[loading_cache].data == nullptr) {
-		m_cached_data[loading_cache].data = new uint8_t[m_cache_size];
-	}
-
-	m_cached_data[loading_cache].base = base_pos;
-
-	if (fseek(m_file, m_cached_data[loading_cache].base, SEEK_SET) != 0) {
-		m_lastError = ERROR_SEEK_ERROR;
-		return -1;
-	}
-
-	uint32_t size = fread(m_cached_data[loading_cache].data, 1, m_cache_size, m_file);
-	m_cached_data[loading_cache].size = size;
-
-	if (size < (pos - m_cached_data[loading_cache].base)) {
-		m_lastError = ERROR_SEEK_ERROR;
-		return -1;
-	}
-
-	m_cached_data[loading_cache].loaded = 1;
-	return loading_cache;
-}
@@ -20,57 +20,38 @@
 #ifndef FS_FILELOADER_H_9B663D19E58D42E6BFACFE5B09D7A05E
 #define FS_FILELOADER_H_9B663D19E58D42E6BFACFE5B09D7A05E
 
+#include <deque>
+
+namespace boost {
+namespace interprocess {
+class mapped_region;
+}
+}
+
 struct NodeStruct;
 
 typedef NodeStruct* NODE;
 
+// Nodes point straight into the mapped file, they live in the pools of the
+// FileLoader that parsed them and are freed along with it.
 struct NodeStruct {
-	NodeStruct() : start(0), propsSize(0), type(0), next(nullptr), child(nullptr) {}
-	~NodeStruct() {}
+	NodeStruct() : props(nullptr), propsSize(0), type(0), escaped(false), next(nullptr), child(nullptr) {}
 
-	uint32_t start;
+	const uint8_t* props;
 	uint32_t propsSize;
 	uint32_t type;
+	bool escaped;
 	NodeStruct* next;
 	NodeStruct* child;
-
-	static void clearNet(NodeStruct* root) {
-		if (root) {
-			clearChild(root);
-		}
-	}
-
-	private:
-		static void clearNext(NodeStruct* node) {
-			NodeStruct* deleteNode = node;
-			NodeStruct* nextNode;
-
-			while (deleteNode) {
-				if (deleteNode->child) {
-					clearChild(deleteNode->child);
-				}
-
-				nextNode = deleteNode->next;
-				delete deleteNode;
-				deleteNode = nextNode;
-			}
-		}
-
-		static void clearChild(NodeStruct* node) {
-			if (node->child) {
-				clearChild(node->child);
-			}
-
-			if (node->next) {
-				clearNext(node->next);
-			}
-
-			delete node;
-		}
 };
 
 #define NO_NODE 0
 
+// Subtrees starting this deep are parsed by worker threads, in an OTBM
+// file those are the tile areas, towns and waypoints.
+#define FILELOADER_PARALLEL_DEPTH 2
+#define FILELOADER_MIN_AUTO_THREADS 4
+
 enum FILELOADER_ERRORS {
 	ERROR_NONE,
 	ERROR_INVALID_FILE_VERSION,
@@ -98,7 +79,8 @@ class FileLoader
 		FileLoader(const FileLoader&) = delete;
 		FileLoader& operator=(const FileLoader&) = delete;
 
-		bool openFile(const char* filename, const char* identifier);
+		// threads = 0 uses one thread per hardware thread, if there are enough
+		bool openFile(const char* filename, const char* identifier, uint32_t threads = 0);
 		const uint8_t* getProps(const NODE, size_t& size);
 		bool getProps(const NODE, PropStream& props);
 		NODE getChildNode(const NODE parent, uint32_t& type);
@@ -107,6 +89,9 @@ class FileLoader
 		int32_t getError() const {
 			return m_lastError;
 		}
+		uint32_t getThreadCount() const {
+			return m_threads;
+		}
 
 	protected:
 		enum SPECIAL_BYTES {
@@ -115,38 +100,38 @@ class FileLoader
 			ESCAPE_CHAR = 0xFD,
 		};
 
-		bool parseNode(NODE node);
+		typedef std::deque<NodeStruct> NodePool;
 
-		inline bool readByte(int32_t& value);
-		inline bool readBytes(uint8_t* buffer, uint32_t size, int32_t pos);
-		inline bool safeSeek(uint32_t pos);
-		inline bool safeTell(int32_t& pos);
+		// the bytes of a node from just past its NODE_START to just past its NODE_END
+		typedef std::pair<const uint8_t*, const uint8_t*> NodeRange;
+		typedef std::vector<NodeRange> NodeRanges;
 
-	protected:
-		struct _cache {
-			uint8_t* data;
-			uint32_t loaded;
-			uint32_t base;
-			uint32_t size;
+		struct DeferredNodes {
+			NodeRanges ranges;
+			std::vector<NODE> nodes;
 		};
 
-#define CACHE_BLOCKS 3
-		_cache m_cached_data[CACHE_BLOCKS];
+		bool parseRoot(DeferredNodes* deferred);
+		// pos is just past the NODE_START of node and is left past its NODE_END
+		bool parseNode(NODE node, const uint8_t*& pos, uint32_t depth, NodePool& pool, DeferredNodes* deferred);
+		bool parseDeferred(const DeferredNodes& deferred);
 
-		uint8_t* m_buffer;
-		NODE m_root;
-		FILE* m_file;
+		// finds the nodes at FILELOADER_PARALLEL_DEPTH by scanning the file in
+		// one chunk per thread, escape chars are recognized without context
+		bool indexNodes(NodeRanges& ranges) const;
+		int32_t scanChunk(const uint8_t* pos, const uint8_t* last, int32_t depth, NodeRanges* ranges) const;
 
-		FILELOADER_ERRORS m_lastError;
-		uint32_t m_buffer_size;
+	protected:
+		std::unique_ptr<boost::interprocess::mapped_region> m_region;
+		const uint8_t* m_data;
+		const uint8_t* m_end;
 
-		uint32_t m_cache_size;
-#define NO_VALID_CACHE 0xFFFFFFFF
-		uint32_t m_cache_index;
-		uint32_t m_cache_offset;
+		std::vector<NodePool> m_pools;
+		std::vector<uint8_t> m_buffer;
+		NODE m_root;
 
-		inline uint32_t getCacheBlock(uint32_t pos);
-		int32_t loadCacheBlock(uint32_t pos);
+		FILELOADER_ERRORS m_lastError;
+		uint32_t m_threads;
 };
 
 class PropStream
@@ -83,7 +83,7 @@ Game::Game() :
 	useLastStageLevel = false;
 	stagesEnabled = false;
 
-	lastBucket = 0;
+	decayTick = 0;
 
 	//(1440 minutes/day)/(3600 seconds/day)*10 seconds event interval
 	int32_t dayCycle = 3600;
@@ -241,7 +241,7 @@ void Game::loadMap(const std::string& path)
 	map.loadMap(path, false);
 }
 
-Cylinder* Game::internalGetCylinder(Player* player, const Position& pos) const
+Cylinder* Game::internalGetCylinder(Player* player, const Position& pos)
 {
 	if (pos.x != 0xFFFF) {
 		return getTile(pos.x, pos.y, pos.z);
@@ -257,7 +257,7 @@ Cylinder* Game::internalGetCylinder(Player* player, const Position& pos) const
 	return player;
 }
 
-Thing* Game::internalGetThing(Player* player, const Position& pos, int32_t index, uint32_t spriteId /*= 0*/, stackPosType_t type /*= STACKPOS_NORMAL*/) const
+Thing* Game::internalGetThing(Player* player, const Position& pos, int32_t index, uint32_t spriteId /*= 0*/, stackPosType_t type /*= STACKPOS_NORMAL*/)
 {
 	if (pos.x != 0xFFFF) {
 		Tile* tile = getTile(pos.x, pos.y, pos.z);
@@ -395,16 +395,21 @@ void Game::setTile(Tile* newTile)
 	return map.setTile(newTile->getPosition(), newTile);
 }
 
-Tile* Game::getTile(int32_t x, int32_t y, int32_t z) const
+Tile* Game::getTile(int32_t x, int32_t y, int32_t z)
 {
 	return map.getTile(x, y, z);
 }
 
-Tile* Game::getTile(const Position& pos) const
+Tile* Game::getTile(const Position& pos)
 {
 	return map.getTile(pos.x, pos.y, pos.z);
 }
 
+const Tile* Game::peekTile(int32_t x, int32_t y, int32_t z) const
+{
+	return map.peekTile(x, y, z);
+}
+
 Creature* Game::getCreatureByID(uint32_t id)
 {
 	if (id <= Player::playerAutoID) {
@@ -770,7 +775,11 @@ bool Game::placeCreature(Creature* creature, const Position& pos, bool extendedP
 		}
 	}
 
-	addCreatureCheck(creature);
+	// idle monsters are only scheduled once Monster::setIdle wakes them up
+	Monster* monster = creature->getMonster();
+	if (!monster || !monster->getIdleStatus()) {
+		addCreatureCheck(creature);
+	}
 	creature->onPlacedCreature();
 	return true;
 }
@@ -799,6 +808,8 @@ bool Game::removeCreature(Creature* creature, bool isLogout /*= true*/)
 		return false;
 	}
 
+	map.removeFlowField(*creature);
+
 	const Position& tilePosition = tile->getPosition();
 
 	//send to client
@@ -4453,14 +4464,39 @@ void Game::startDecay(Item* item)
 	}
 
 	if (item->getDuration() > 0) {
-		item->useThing2();
 		item->setDecaying(DECAYING_TRUE);
-		toDecayItems.push_front(item);
+		scheduleDecay(item);
 	} else {
 		internalDecayItem(item);
 	}
 }
 
+void Game::scheduleDecay(Item* item)
+{
+	// the slot of decayTick is the next one checked, so round up to whole ticks
+	uint32_t duration = std::max<int32_t>(item->getIntAttr(ITEM_ATTRIBUTE_DURATION), 1);
+	uint32_t tick = decayTick + (duration + EVENT_DECAYINTERVAL - 1) / EVENT_DECAYINTERVAL;
+
+	item->setIntAttr(ITEM_ATTRIBUTE_DURATION_TIMESTAMP, tick);
+	item->useThing2();
+	insertDecayEntry(item, tick);
+}
+
+void Game::insertDecayEntry(Item* item, uint32_t tick)
+{
+	const uint32_t maxDelta = (static_cast<uint32_t>(1) << (DECAY_WHEEL_LEVELS * DECAY_WHEEL_BITS)) - 1;
+
+	// an expiry past the outer wheel is parked at its end and reinserted from there
+	uint32_t slotTick = decayTick + std::min<uint32_t>(tick - decayTick, maxDelta);
+	uint32_t delta = slotTick - decayTick;
+
+	uint32_t level = 0;
+	while (delta >> ((level + 1) * DECAY_WHEEL_BITS)) {
+		++level;
+	}
+	decayWheel[level][(slotTick >> (level * DECAY_WHEEL_BITS)) & DECAY_WHEEL_MASK].push_back(DecayEntry{item, tick});
+}
+
 void Game::internalDecayItem(Item* item)
 {
 	const ItemType& it = Item::items[item->getID()];
@@ -4479,48 +4515,69 @@ void Game::checkDecay()
 {
 	g_scheduler.addEvent(createSchedulerTask(EVENT_DECAYINTERVAL, std::bind(&Game::checkDecay, this)));
 
-	size_t bucket = (lastBucket + 1) % EVENT_DECAY_BUCKETS;
+	const uint32_t tick = decayTick;
 
-	for (auto it = decayItems[bucket].begin(); it != decayItems[bucket].end();) {
-		Item* item = *it;
-		if (!item->canDecay()) {
-			item->setDecaying(DECAYING_FALSE);
-			ReleaseItem(item);
-			it = decayItems[bucket].erase(it);
-			continue;
+	// at the start of every inner round move the current slot of each outer
+	// wheel whose round starts as well one level inwards
+	for (uint32_t level = 1; level < DECAY_WHEEL_LEVELS && (tick & ((1 << (level * DECAY_WHEEL_BITS)) - 1)) == 0; ++level) {
+		std::vector<DecayEntry> entries;
+		entries.swap(decayWheel[level][(tick >> (level * DECAY_WHEEL_BITS)) & DECAY_WHEEL_MASK]);
+		for (const DecayEntry& entry : entries) {
+			insertDecayEntry(entry.item, entry.tick);
 		}
+	}
 
-		int32_t decreaseTime = EVENT_DECAYINTERVAL * EVENT_DECAY_BUCKETS;
-		int32_t duration = item->getDuration();
-		if (duration - decreaseTime < 0) {
-			decreaseTime = duration;
-		}
+	sweepDecayWheel(tick);
+
+	std::vector<DecayEntry> entries;
+	entries.swap(decayWheel[0][tick & DECAY_WHEEL_MASK]);
 
-		duration -= decreaseTime;
-		item->decreaseDuration(decreaseTime);
+	++decayTick;
+
+	for (const DecayEntry& entry : entries) {
+		if (releaseStaleDecayEntry(entry)) {
+			continue;
+		}
 
-		if (duration <= 0) {
-			it = decayItems[bucket].erase(it);
+		Item* item = entry.item;
+		if (entry.tick != tick) {
+			insertDecayEntry(item, entry.tick);
+		} else {
 			internalDecayItem(item);
 			ReleaseItem(item);
-		} else if (duration < EVENT_DECAYINTERVAL * EVENT_DECAY_BUCKETS) {
-			it = decayItems[bucket].erase(it);
-			size_t newBucket = (bucket + ((duration + EVENT_DECAYINTERVAL / 2) / 1000)) % EVENT_DECAY_BUCKETS;
-			if (newBucket == bucket) {
-				internalDecayItem(item);
-				ReleaseItem(item);
-			} else {
-				decayItems[newBucket].push_back(item);
-			}
-		} else {
-			++it;
 		}
 	}
 
-	lastBucket = bucket;
 	cleanup();
 }
 
+void Game::sweepDecayWheel(uint32_t tick)
+{
+	// an outer slot comes up only every 4.5 hours or 48 days, one of them is
+	// swept per check so removed items are let go within about two minutes
+	const uint32_t sweep = tick % ((DECAY_WHEEL_LEVELS - 1) * DECAY_WHEEL_SIZE);
+	std::vector<DecayEntry>& entries = decayWheel[1 + sweep / DECAY_WHEEL_SIZE][sweep & DECAY_WHEEL_MASK];
+	entries.erase(std::remove_if(entries.begin(), entries.end(), [this](const DecayEntry& entry) {
+		return releaseStaleDecayEntry(entry);
+	}), entries.end());
+}
+
+bool Game::releaseStaleDecayEntry(const DecayEntry& entry)
+{
+	Item* item = entry.item;
+	if (item->getDecaying() != DECAYING_TRUE || static_cast<uint32_t>(item->getIntAttr(ITEM_ATTRIBUTE_DURATION_TIMESTAMP)) != entry.tick) {
+		ReleaseItem(item);
+		return true;
+	}
+
+	if (!item->canDecay()) {
+		item->setDecaying(DECAYING_FALSE);
+		ReleaseItem(item);
+		return true;
+	}
+	return false;
+}
+
 void Game::checkLight()
 {
 	g_scheduler.addEvent(createSchedulerTask(EVENT_LIGHTINTERVAL, std::bind(&Game::checkLight, this)));
@@ -4629,16 +4686,6 @@ void Game::cleanup()
 		item->releaseThing2();
 	}
 	ToReleaseItems.clear();
-
-	for (Item* item : toDecayItems) {
-		const uint32_t dur = item->getDuration();
-		if (dur >= EVENT_DECAYINTERVAL * EVENT_DECAY_BUCKETS) {
-			decayItems[lastBucket].push_back(item);
-		} else {
-			decayItems[(lastBucket + 1 + dur / 1000) % EVENT_DECAY_BUCKETS].push_back(item);
-		}
-	}
-	toDecayItems.clear();
 }
 
 void Game::ReleaseCreature(Creature* creature)
@@ -71,7 +71,15 @@ enum LightState_t {
 
 #define EVENT_LIGHTINTERVAL 10000
 #define EVENT_DECAYINTERVAL 250
-#define EVENT_DECAY_BUCKETS 4
+
+// Decaying items are kept in a hierarchical timer wheel by the decay tick
+// they expire at, one tick per EVENT_DECAYINTERVAL. The inner wheel covers
+// the next 64 seconds, every outer one 256 times the span of the one inside
+// it, items decaying even later are reinserted when they come up.
+#define DECAY_WHEEL_BITS 8
+#define DECAY_WHEEL_SIZE (1 << DECAY_WHEEL_BITS)
+#define DECAY_WHEEL_MASK (DECAY_WHEEL_SIZE - 1)
+#define DECAY_WHEEL_LEVELS 3
 
 /**
   * Main Game class.
@@ -107,9 +115,9 @@ class Game
 			return worldType;
 		}
 
-		Cylinder* internalGetCylinder(Player* player, const Position& pos) const;
+		Cylinder* internalGetCylinder(Player* player, const Position& pos);
 		Thing* internalGetThing(Player* player, const Position& pos, int32_t index,
-		                        uint32_t spriteId = 0, stackPosType_t type = STACKPOS_NORMAL) const;
+		                        uint32_t spriteId = 0, stackPosType_t type = STACKPOS_NORMAL);
 		static void internalGetPosition(Item* item, Position& pos, uint8_t& stackpos);
 
 		static std::string getTradeErrorDescription(ReturnValue ret, Item* item);
@@ -118,8 +126,14 @@ class Game
 		  * Get a single tile of the map.
 		  * \returns A pointer to the tile
 		*/
-		Tile* getTile(int32_t x, int32_t y, int32_t z) const;
-		Tile* getTile(const Position& pos) const;
+		Tile* getTile(int32_t x, int32_t y, int32_t z);
+		Tile* getTile(const Position& pos);
+
+		/**
+		  * Get a single tile of the map for reading only, see Map::peekTile.
+		  * \returns A pointer to the tile
+		*/
+		const Tile* peekTile(int32_t x, int32_t y, int32_t z) const;
 
 		/**
 		  * Set a single tile of the map, position is read from this tile
@@ -248,8 +262,20 @@ class Game
 			return map.getSpectators(centerPos);
 		}
 
-		void clearSpectatorCache() {
-			map.clearSpectatorCache();
+		void trimSpectatorCache() {
+			map.trimSpectatorCache();
+		}
+		uint64_t getSpectatorCacheHits() const {
+			return map.getSpectatorCacheHits();
+		}
+		uint64_t getSpectatorCacheMisses() const {
+			return map.getSpectatorCacheMisses();
+		}
+		size_t getSharedTileCount() const {
+			return map.getSharedTileCount();
+		}
+		uint64_t getUnsharedTileCount() const {
+			return map.getUnsharedTileCount();
 		}
 
 		ReturnValue internalMoveCreature(Creature* creature, Direction direction, uint32_t flags = 0);
@@ -477,6 +503,14 @@ class Game
 		void resetCommandTag();
 
 		void startDecay(Item* item);
+		void scheduleDecay(Item* item);
+
+		/**
+		  * \returns the time left in milliseconds until the given decay tick
+		  */
+		uint32_t getDecayDuration(uint32_t tick) const {
+			return tick > decayTick ? (tick - decayTick) * EVENT_DECAYINTERVAL : 0;
+		}
 		int32_t getLightHour() const {
 			return lightHour;
 		}
@@ -530,6 +564,8 @@ class Game
 
 		void checkDecay();
 		void internalDecayItem(Item* item);
+		void insertDecayEntry(Item* item, uint32_t tick);
+		void sweepDecayWheel(uint32_t tick);
 
 		Map map;
 
@@ -538,16 +574,23 @@ class Game
 		std::unordered_map<uint32_t, Guild*> guilds;
 		std::map<uint32_t, uint32_t> stages;
 
-		std::list<Item*> decayItems[EVENT_DECAY_BUCKETS];
-		std::list<Creature*> checkCreatureLists[EVENT_CREATURECOUNT];
+		struct DecayEntry {
+			Item* item;
+			uint32_t tick;
+		};
+		bool releaseStaleDecayEntry(const DecayEntry& entry);
 
-		std::forward_list<Item*> toDecayItems;
+		// every entry holds a reference on its item, entries whose item stopped
+		// decaying, got a new expiry tick or was removed since are dropped when
+		// they come up or, in the outer wheels, when sweepDecayWheel reaches them
+		std::vector<DecayEntry> decayWheel[DECAY_WHEEL_LEVELS][DECAY_WHEEL_SIZE];
+		std::list<Creature*> checkCreatureLists[EVENT_CREATURECOUNT];
 
 		std::vector<Creature*> ToReleaseCreatures;
 		std::vector<Item*> ToReleaseItems;
 		std::vector<char> commandTags;
 
-		size_t lastBucket;
+		uint32_t decayTick;
 
 		WildcardTreeNode wildcardTree;
 
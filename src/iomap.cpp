@@ -61,8 +61,10 @@ Tile* IOMap::createTile(Item*& ground, Item* item, int px, int py, int pz)
 		return new StaticTile(px, py, pz);
 	}
 
+	// bare walkable ground gets its item and creature lists on first use,
+	// most of it is never touched by anything
 	Tile* tile;
-	if ((item && item->isBlocking()) || ground->isBlocking()) {
+	if (!item || item->isBlocking() || ground->isBlocking()) {
 		tile = new StaticTile(px, py, pz);
 	} else {
 		tile = new DynamicTile(px, py, pz);
@@ -77,6 +79,7 @@ Tile* IOMap::createTile(Item*& ground, Item* item, int px, int py, int pz)
 bool IOMap::loadMap(Map* map, const std::string& identifier)
 {
 	int64_t start = OTSYS_TIME();
+	uint64_t residentBefore = getResidentMemory();
 
 	FileLoader f;
 
@@ -87,6 +90,8 @@ bool IOMap::loadMap(Map* map, const std::string& identifier)
 		return false;
 	}
 
+	std::cout << "> Map file parsed in " << (OTSYS_TIME() - start) / (1000.) << " seconds using " << f.getThreadCount() << " thread(s)." << std::endl;
+
 	uint32_t type;
 	PropStream propStream;
 
@@ -401,7 +406,7 @@ bool IOMap::loadMap(Map* map, const std::string& identifier)
 
 				tile->setFlag(static_cast<tileflags_t>(tileflags));
 
-				map->setTile(px, py, pz, tile);
+				map->setLoadedTile(px, py, pz, tile);
 
 				nodeTile = f.getNextNode(nodeTile, type);
 			}
@@ -486,5 +491,12 @@ bool IOMap::loadMap(Map* map, const std::string& identifier)
 	}
 
 	std::cout << "> Map loading time: " << (OTSYS_TIME() - start) / (1000.) << " seconds." << std::endl;
+	std::cout << "> Map shared tiles: " << map->getSharedTileCount() << " distinct decoration tiles." << std::endl;
+	std::cout << "> Map tile memory: " << TileAllocator::getUsedBytes() / (1024 * 1024) << " MB in use, " << TileAllocator::getReservedBytes() / (1024 * 1024) << " MB reserved." << std::endl;
+
+	uint64_t residentAfter = getResidentMemory();
+	if (residentBefore != 0 && residentAfter != 0) {
+		std::cout << "> Resident memory: " << residentBefore / (1024 * 1024) << " MB before, " << residentAfter / (1024 * 1024) << " MB after loading the map." << std::endl;
+	}
 	return true;
 }
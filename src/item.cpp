@@ -199,6 +199,7 @@ void Item::moveAttributes(Item* item)
 
 	removeAttribute(ITEM_ATTRIBUTE_DECAYSTATE);
 	removeAttribute(ITEM_ATTRIBUTE_DURATION);
+	removeAttribute(ITEM_ATTRIBUTE_DURATION_TIMESTAMP);
 }
 
 Item::~Item()
@@ -263,6 +264,11 @@ void Item::setID(uint16_t newid)
 	const ItemType& prevIt = Item::items[id];
 	id = newid;
 
+	// keep what is left of the duration if the new type stops decaying
+	if (getDecaying() == DECAYING_TRUE && !canDecay()) {
+		setDecaying(DECAYING_FALSE);
+	}
+
 	const ItemType& it = Item::items[newid];
 	uint32_t newDuration = it.decayTime * 1000;
 
@@ -704,7 +710,7 @@ bool Item::serializeAttr(PropWriteStream& propWriteStream) const
 
 	if (hasAttribute(ITEM_ATTRIBUTE_DURATION)) {
 		propWriteStream.write<uint8_t>(ATTR_DURATION);
-		propWriteStream.write<uint32_t>(getIntAttr(ITEM_ATTRIBUTE_DURATION));
+		propWriteStream.write<uint32_t>(getDuration());
 	}
 
 	ItemDecayState_t decayState = getDecaying();
@@ -1614,6 +1620,35 @@ ItemAttributes::Attribute& ItemAttributes::getAttr(itemAttrTypes type)
 	return attributes.front();
 }
 
+void Item::setDuration(int32_t time)
+{
+	setIntAttr(ITEM_ATTRIBUTE_DURATION, time);
+	if (getDecaying() == DECAYING_TRUE) {
+		g_game.scheduleDecay(this);
+	}
+}
+
+uint32_t Item::getDuration() const
+{
+	if (!attributes) {
+		return 0;
+	}
+
+	if (getDecaying() == DECAYING_TRUE && hasAttribute(ITEM_ATTRIBUTE_DURATION_TIMESTAMP)) {
+		return g_game.getDecayDuration(getIntAttr(ITEM_ATTRIBUTE_DURATION_TIMESTAMP));
+	}
+	return getIntAttr(ITEM_ATTRIBUTE_DURATION);
+}
+
+void Item::setDecaying(ItemDecayState_t decayState)
+{
+	if (decayState != DECAYING_TRUE && getDecaying() == DECAYING_TRUE) {
+		setIntAttr(ITEM_ATTRIBUTE_DURATION, getDuration());
+		removeAttribute(ITEM_ATTRIBUTE_DURATION_TIMESTAMP);
+	}
+	setIntAttr(ITEM_ATTRIBUTE_DECAYSTATE, decayState);
+}
+
 void Item::__startDecaying()
 {
 	g_game.startDecay(this);
@@ -47,6 +47,7 @@
 #include "scheduler.h"
 #include "raids.h"
 #include "databasetasks.h"
+#include "outputmessage.h"
 
 extern Chat* g_chat;
 extern Game g_game;
@@ -1939,6 +1940,11 @@ void LuaScriptInterface::registerFunctions()
 	registerMethod("Game", "getPlayerCount", LuaScriptInterface::luaGameGetPlayerCount);
 	registerMethod("Game", "getNpcCount", LuaScriptInterface::luaGameGetNpcCount);
 
+	registerMethod("Game", "getTaskStats", LuaScriptInterface::luaGameGetTaskStats);
+	registerMethod("Game", "getOutputMessageStats", LuaScriptInterface::luaGameGetOutputMessageStats);
+	registerMethod("Game", "getSpectatorCacheStats", LuaScriptInterface::luaGameGetSpectatorCacheStats);
+	registerMethod("Game", "getSharedTileStats", LuaScriptInterface::luaGameGetSharedTileStats);
+
 	registerMethod("Game", "getTowns", LuaScriptInterface::luaGameGetTowns);
 	registerMethod("Game", "getHouses", LuaScriptInterface::luaGameGetHouses);
 
@@ -4853,6 +4859,48 @@ int32_t LuaScriptInterface::luaGameGetNpcCount(lua_State* L)
 	return 1;
 }
 
+int32_t LuaScriptInterface::luaGameGetTaskStats(lua_State* L)
+{
+	// Game.getTaskStats()
+	// counters are totals since startup, sample them twice to get rates
+	lua_createtable(L, 0, 3);
+	setField(L, "allocations", TaskAllocator::getAllocations());
+	setField(L, "heapAllocations", TaskAllocator::getHeapAllocations());
+	setField(L, "functionHeapAllocations", TaskFunction::getHeapAllocations());
+	return 1;
+}
+
+int32_t LuaScriptInterface::luaGameGetOutputMessageStats(lua_State* L)
+{
+	// Game.getOutputMessageStats()
+	OutputMessagePool* outputPool = OutputMessagePool::getInstance();
+	lua_createtable(L, 0, 3);
+	setField(L, "hits", outputPool->getPoolHits());
+	setField(L, "misses", outputPool->getPoolMisses());
+	setField(L, "outstanding", outputPool->getOutstandingMessages());
+	return 1;
+}
+
+int32_t LuaScriptInterface::luaGameGetSpectatorCacheStats(lua_State* L)
+{
+	// Game.getSpectatorCacheStats()
+	// counters are totals since startup, sample them twice to get rates
+	lua_createtable(L, 0, 2);
+	setField(L, "hits", g_game.getSpectatorCacheHits());
+	setField(L, "misses", g_game.getSpectatorCacheMisses());
+	return 1;
+}
+
+int32_t LuaScriptInterface::luaGameGetSharedTileStats(lua_State* L)
+{
+	// Game.getSharedTileStats()
+	// unshared counts the map positions that got a tile of their own since startup
+	lua_createtable(L, 0, 2);
+	setField(L, "entries", g_game.getSharedTileCount());
+	setField(L, "unshared", g_game.getUnsharedTileCount());
+	return 1;
+}
+
 int32_t LuaScriptInterface::luaGameGetTowns(lua_State* L)
 {
 	// Game.getTowns()
@@ -6822,7 +6870,9 @@ int32_t LuaScriptInterface::luaItemGetAttribute(lua_State* L)
 		attribute = ITEM_ATTRIBUTE_NONE;
 	}
 
-	if (ItemAttributes::isIntAttrType(attribute)) {
+	if (attribute == ITEM_ATTRIBUTE_DURATION) {
+		lua_pushnumber(L, item->getDuration());
+	} else if (ItemAttributes::isIntAttrType(attribute)) {
 		lua_pushnumber(L, item->getIntAttr(attribute));
 	} else if (ItemAttributes::isStrAttrType(attribute)) {
 		pushString(L, item->getStrAttr(attribute));
@@ -6850,7 +6900,10 @@ int32_t LuaScriptInterface::luaItemSetAttribute(lua_State* L)
 		attribute = ITEM_ATTRIBUTE_NONE;
 	}
 
-	if (ItemAttributes::isIntAttrType(attribute)) {
+	if (attribute == ITEM_ATTRIBUTE_DURATION) {
+		item->setDuration(getNumber<int32_t>(L, 3));
+		pushBoolean(L, true);
+	} else if (ItemAttributes::isIntAttrType(attribute)) {
 		item->setIntAttr(attribute, getNumber<int32_t>(L, 3));
 		pushBoolean(L, true);
 	} else if (ItemAttributes::isStrAttrType(attribute)) {
@@ -566,6 +566,11 @@ class LuaScriptInterface
 		static int32_t luaGameGetPlayerCount(lua_State* L);
 		static int32_t luaGameGetNpcCount(lua_State* L);
 
+		static int32_t luaGameGetTaskStats(lua_State* L);
+		static int32_t luaGameGetOutputMessageStats(lua_State* L);
+		static int32_t luaGameGetSpectatorCacheStats(lua_State* L);
+		static int32_t luaGameGetSharedTileStats(lua_State* L);
+
 		static int32_t luaGameGetTowns(lua_State* L);
 		static int32_t luaGameGetHouses(lua_State* L);
 
@@ -28,12 +28,26 @@
 #include "creature.h"
 #include "game.h"
 
+#include <queue>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MAP_SSE2
+#include <emmintrin.h>
+#endif
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
 extern Game g_game;
 
 Map::Map()
 {
 	mapWidth = 0;
 	mapHeight = 0;
+	spectatorCacheHits = 0;
+	spectatorCacheMisses = 0;
+	sightVersion = 0;
+	unsharedTileCount = 0;
 }
 
 Map::~Map()
@@ -61,6 +75,8 @@ bool Map::loadMap(const std::string& identifier, bool loadHouses)
 		IOMapSerialize::loadHouseInfo();
 		IOMapSerialize::loadHouseItems(this);
 	}
+
+	sectorGraph.build(*this);
 	return true;
 }
 
@@ -88,7 +104,32 @@ bool Map::saveMap()
 	return saved;
 }
 
-Tile* Map::getTile(int32_t x, int32_t y, int32_t z) const
+Tile* Map::getTile(int32_t x, int32_t y, int32_t z)
+{
+	if (x < 0 || x >= 0xFFFF || y < 0 || y >= 0xFFFF || z < 0 || z >= MAP_MAX_LAYERS) {
+		return nullptr;
+	}
+
+	QTreeLeafNode* leaf = root.getLeaf(x, y);
+	if (!leaf) {
+		return nullptr;
+	}
+
+	Floor* floor = leaf->getFloor(z);
+	if (!floor) {
+		return nullptr;
+	}
+
+	Tile*& tile = floor->tiles[x & FLOOR_MASK][y & FLOOR_MASK];
+	if (Floor::isShared(tile)) {
+		tile = createSharedTile(sharedTiles[Floor::getSharedIndex(tile)], x, y, z);
+		tile->qt_node = leaf;
+		++unsharedTileCount;
+	}
+	return tile;
+}
+
+const Tile* Map::peekTile(int32_t x, int32_t y, int32_t z) const
 {
 	if (x < 0 || x >= 0xFFFF || y < 0 || y >= 0xFFFF || z < 0 || z >= MAP_MAX_LAYERS) {
 		return nullptr;
@@ -103,7 +144,23 @@ Tile* Map::getTile(int32_t x, int32_t y, int32_t z) const
 	if (!floor) {
 		return nullptr;
 	}
-	return floor->tiles[x & FLOOR_MASK][y & FLOOR_MASK];
+
+	const Tile* tile = floor->tiles[x & FLOOR_MASK][y & FLOOR_MASK];
+	if (Floor::isShared(tile)) {
+		return sharedTiles[Floor::getSharedIndex(tile)].tile.get();
+	}
+	return tile;
+}
+
+bool Map::getGroundTileFlags(int32_t x, int32_t y, int32_t z, uint32_t& flags) const
+{
+	const Tile* tile = peekTile(x, y, z);
+	if (!tile || !tile->ground) {
+		return false;
+	}
+
+	flags = tile->getFlags();
+	return true;
 }
 
 void Map::setTile(int32_t x, int32_t y, int32_t z, Tile* newTile)
@@ -147,9 +204,113 @@ void Map::setTile(int32_t x, int32_t y, int32_t z, Tile* newTile)
 	uint32_t offsetY = y & FLOOR_MASK;
 
 	Tile*& tile = floor->tiles[offsetX][offsetY];
-	delete tile;
+	if (!Floor::isShared(tile)) {
+		delete tile;
+	}
 	tile = newTile;
 	newTile->qt_node = leaf;
+
+	if (newTile->hasFlag(TILESTATE_BLOCKPROJECTILE)) {
+		floor->sightBlock |= Floor::getSightBit(x, y);
+	} else {
+		floor->sightBlock &= ~Floor::getSightBit(x, y);
+	}
+	++sightVersion;
+
+	sectorGraph.addTile(Position(x, y, z));
+}
+
+void Map::setLoadedTile(int32_t x, int32_t y, int32_t z, Tile* newTile)
+{
+	setTile(x, y, z, newTile);
+	if (!isShareableTile(newTile)) {
+		return;
+	}
+
+	// items are added back in an order that rebuilds the same stack
+	std::vector<uint16_t> key {
+		static_cast<uint16_t>(newTile->getFlags()),
+		static_cast<uint16_t>(newTile->getFlags() >> 16),
+		newTile->ground->getID()
+	};
+
+	if (const TileItemVector* items = newTile->getItemList()) {
+		for (auto it = items->getBeginTopItem(), end = items->getEndTopItem(); it != end; ++it) {
+			key.push_back((*it)->getID());
+		}
+
+		for (auto it = items->getEndDownItem(), begin = items->getBeginDownItem(); it != begin;) {
+			key.push_back((*--it)->getID());
+		}
+	}
+
+	auto it = sharedTileIndex.find(key);
+	if (it == sharedTileIndex.end()) {
+		SharedTile shared;
+		shared.flags = newTile->getFlags();
+		shared.itemIds.assign(key.begin() + 2, key.end());
+		shared.tile.reset(createSharedTile(shared, x, y, z));
+
+		it = sharedTileIndex.emplace(std::move(key), sharedTiles.size()).first;
+		sharedTiles.push_back(std::move(shared));
+	}
+
+	root.getLeaf(x, y)->getFloor(z)->tiles[x & FLOOR_MASK][y & FLOOR_MASK] = Floor::makeShared(it->second);
+	delete newTile;
+}
+
+bool Map::isShareableTile(const Tile* tile)
+{
+	if (!tile->ground || tile->hasFlag(TILESTATE_HOUSE) || tile->getCreatureCount() != 0) {
+		return false;
+	}
+
+	if (!isShareableItem(tile->ground)) {
+		return false;
+	}
+
+	if (const TileItemVector* items = tile->getItemList()) {
+		for (const Item* item : *items) {
+			if (!isShareableItem(item)) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+bool Map::isShareableItem(const Item* item)
+{
+	const ItemType& it = Item::items[item->getID()];
+	if (item->hasAttributes() || it.hasSubType() || it.moveable) {
+		return false;
+	}
+
+	// these have state or are created as their own classes
+	if (it.isContainer() || it.isDepot() || it.isTeleport() || it.isMagicField() || it.isDoor() ||
+	        it.isTrashHolder() || it.isMailbox() || it.isBed()) {
+		return false;
+	}
+	return it.decayTo == -1 || it.decayTime == 0;
+}
+
+Tile* Map::createSharedTile(const SharedTile& shared, int32_t x, int32_t y, int32_t z)
+{
+	Tile* tile;
+	if ((shared.flags & TILESTATE_DYNAMIC_TILE) != 0) {
+		tile = new DynamicTile(x, y, z);
+	} else {
+		tile = new StaticTile(x, y, z);
+	}
+
+	for (uint16_t id : shared.itemIds) {
+		Item* item = Item::CreateItem(id);
+		tile->__internalAddThing(item);
+		item->setLoadedFromMap(true);
+	}
+
+	tile->setFlag(static_cast<tileflags_t>(shared.flags));
+	return tile;
 }
 
 bool Map::placeCreature(const Position& centerPos, Creature* creature, bool extendedPos /*=false*/, bool forceLogin /*=false*/)
@@ -234,6 +395,81 @@ bool Map::removeCreature(Creature* creature)
 	return true;
 }
 
+namespace {
+
+
+void addSpectators(SpectatorVec& list, const LeafCreatures& creatures,
+                   int32_t minX, int32_t maxX, int32_t minY, int32_t maxY, int32_t minZ, int32_t maxZ)
+{
+	const size_t size = creatures.list.size();
+	size_t i = 0;
+
+#ifdef __AVX2__
+	if (size >= 8) {
+		// compares are "greater than" only, so the bounds are widened by one
+		const __m256i lowX = _mm256_set1_epi32(minX - 1), highX = _mm256_set1_epi32(maxX + 1);
+		const __m256i lowY = _mm256_set1_epi32(minY - 1), highY = _mm256_set1_epi32(maxY + 1);
+		const __m256i lowZ = _mm256_set1_epi32(minZ - 1), highZ = _mm256_set1_epi32(maxZ + 1);
+		for (; i + 8 <= size; i += 8) {
+			__m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&creatures.x[i]));
+			__m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&creatures.y[i]));
+			__m256i z = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&creatures.z[i]));
+
+			__m256i in = _mm256_and_si256(_mm256_cmpgt_epi32(x, lowX), _mm256_cmpgt_epi32(highX, x));
+			in = _mm256_and_si256(in, _mm256_and_si256(_mm256_cmpgt_epi32(y, lowY), _mm256_cmpgt_epi32(highY, y)));
+			in = _mm256_and_si256(in, _mm256_and_si256(_mm256_cmpgt_epi32(z, lowZ), _mm256_cmpgt_epi32(highZ, z)));
+
+			for (int32_t mask = _mm256_movemask_ps(_mm256_castsi256_ps(in)), j = 0; mask != 0; mask >>= 1, ++j) {
+				if (mask & 1) {
+					list.emplace_back(creatures.list[i + j]);
+				}
+			}
+		}
+	}
+#endif
+
+#ifdef MAP_SSE2
+	if (size - i >= 4) {
+		const __m128i lowX = _mm_set1_epi32(minX - 1), highX = _mm_set1_epi32(maxX + 1);
+		const __m128i lowY = _mm_set1_epi32(minY - 1), highY = _mm_set1_epi32(maxY + 1);
+		const __m128i lowZ = _mm_set1_epi32(minZ - 1), highZ = _mm_set1_epi32(maxZ + 1);
+		for (; i + 4 <= size; i += 4) {
+			__m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&creatures.x[i]));
+			__m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&creatures.y[i]));
+			__m128i z = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&creatures.z[i]));
+
+			__m128i in = _mm_and_si128(_mm_cmpgt_epi32(x, lowX), _mm_cmplt_epi32(x, highX));
+			in = _mm_and_si128(in, _mm_and_si128(_mm_cmpgt_epi32(y, lowY), _mm_cmplt_epi32(y, highY)));
+			in = _mm_and_si128(in, _mm_and_si128(_mm_cmpgt_epi32(z, lowZ), _mm_cmplt_epi32(z, highZ)));
+
+			for (int32_t mask = _mm_movemask_ps(_mm_castsi128_ps(in)), j = 0; mask != 0; mask >>= 1, ++j) {
+				if (mask & 1) {
+					list.emplace_back(creatures.list[i + j]);
+				}
+			}
+		}
+	}
+#endif
+
+	for (; i < size; ++i) {
+		if (creatures.z[i] < minZ || creatures.z[i] > maxZ) {
+			continue;
+		}
+
+		if (creatures.y[i] < minY || creatures.y[i] > maxY) {
+			continue;
+		}
+
+		if (creatures.x[i] < minX || creatures.x[i] > maxX) {
+			continue;
+		}
+
+		list.emplace_back(creatures.list[i]);
+	}
+}
+
+}
+
 void Map::getSpectatorsInternal(SpectatorVec& list, const Position& centerPos, int32_t minRangeX, int32_t maxRangeX, int32_t minRangeY, int32_t maxRangeY, int32_t minRangeZ, int32_t maxRangeZ, bool onlyPlayers) const
 {
 	int_fast16_t min_y = centerPos.y + minRangeY;
@@ -254,6 +490,17 @@ void Map::getSpectatorsInternal(SpectatorVec& list, const Position& centerPos, i
 	int32_t endx2 = x2 - (x2 % FLOOR_SIZE);
 	int32_t endy2 = y2 - (y2 % FLOOR_SIZE);
 
+	// each creature is in exactly one leaf, so a list that starts out empty
+	// can be filled without checking for duplicates, a list that already
+	// holds creatures is deduplicated once after the scan
+	const size_t mergedFrom = list.size();
+
+	// bounds for the z-adjusted coordinates kept by the leaves
+	const int32_t minX = min_x + centerPos.z;
+	const int32_t maxX = max_x + centerPos.z;
+	const int32_t minY = min_y + centerPos.z;
+	const int32_t maxY = max_y + centerPos.z;
+
 	const QTreeLeafNode* startLeaf = QTreeNode::getLeafStatic(&root, startx1, starty1);
 	const QTreeLeafNode* leafS = startLeaf;
 	const QTreeLeafNode* leafE;
@@ -262,30 +509,8 @@ void Map::getSpectatorsInternal(SpectatorVec& list, const Position& centerPos, i
 		leafE = leafS;
 		for (int_fast32_t nx = startx1; nx <= endx2; nx += FLOOR_SIZE) {
 			if (leafE) {
-				const CreatureVector& node_list = (onlyPlayers ? leafE->player_list : leafE->creature_list);
-				CreatureVector::const_iterator node_iter = node_list.begin();
-				CreatureVector::const_iterator node_end = node_list.end();
-				if (node_iter != node_end) {
-					do {
-						Creature* creature = *node_iter;
-
-						const Position& cpos = creature->getPosition();
-						if (cpos.z < minRangeZ || cpos.z > maxRangeZ) {
-							continue;
-						}
-
-						int_fast16_t offsetZ = Position::getOffsetZ(centerPos, cpos);
-						if (cpos.y < (min_y + offsetZ) || cpos.y > (max_y + offsetZ)) {
-							continue;
-						}
-
-						if (cpos.x < (min_x + offsetZ) || cpos.x > (max_x + offsetZ)) {
-							continue;
-						}
-
-						list.insert(creature);
-					} while (++node_iter != node_end);
-				}
+				const LeafCreatures& node_list = (onlyPlayers ? leafE->player_list : leafE->creature_list);
+				addSpectators(list, node_list, minX, maxX, minY, maxY, minRangeZ, maxRangeZ);
 				leafE = leafE->m_leafE;
 			} else {
 				leafE = QTreeNode::getLeafStatic(&root, nx + FLOOR_SIZE, ny);
@@ -298,6 +523,10 @@ void Map::getSpectatorsInternal(SpectatorVec& list, const Position& centerPos, i
 			leafS = QTreeNode::getLeafStatic(&root, startx1, ny + FLOOR_SIZE);
 		}
 	}
+
+	if (mergedFrom != 0) {
+		list.removeDuplicates(mergedFrom);
+	}
 }
 
 void Map::getSpectators(SpectatorVec& list, const Position& centerPos, bool multifloor /*= false*/, bool onlyPlayers /*= false*/, int32_t minRangeX /*= 0*/, int32_t maxRangeX /*= 0*/, int32_t minRangeY /*= 0*/, int32_t maxRangeY /*= 0*/)
@@ -317,12 +546,12 @@ void Map::getSpectators(SpectatorVec& list, const Position& centerPos, bool mult
 	if (minRangeX == -maxViewportX && maxRangeX == maxViewportX && minRangeY == -maxViewportY && maxRangeY == maxViewportY && multifloor) {
 		if (onlyPlayers) {
 			auto it = playersSpectatorCache.find(centerPos);
-			if (it != playersSpectatorCache.end()) {
+			if (it != playersSpectatorCache.end() && isSpectatorCacheValid(it->second, centerPos)) {
 				if (!list.empty()) {
-					const SpectatorVec& cachedList = *it->second;
+					const SpectatorVec& cachedList = it->second.list;
 					list.insert(cachedList.begin(), cachedList.end());
 				} else {
-					list = *it->second;
+					list = it->second.list;
 				}
 
 				foundCache = true;
@@ -331,21 +560,26 @@ void Map::getSpectators(SpectatorVec& list, const Position& centerPos, bool mult
 
 		if (!foundCache) {
 			auto it = spectatorCache.find(centerPos);
-			if (it != spectatorCache.end()) {
+			if (it != spectatorCache.end() && isSpectatorCacheValid(it->second, centerPos)) {
 				if (!onlyPlayers) {
 					if (!list.empty()) {
-						const SpectatorVec& cachedList = *it->second;
+						const SpectatorVec& cachedList = it->second.list;
 						list.insert(cachedList.begin(), cachedList.end());
 					} else {
-						list = *it->second;
+						list = it->second.list;
 					}
 				} else {
-					const SpectatorVec& cachedList = *it->second;
+					const size_t mergedFrom = list.size();
+					const SpectatorVec& cachedList = it->second.list;
 					for (Creature* spectator : cachedList) {
 						if (spectator->getPlayer()) {
-							list.insert(spectator);
+							list.emplace_back(spectator);
 						}
 					}
+
+					if (mergedFrom != 0) {
+						list.removeDuplicates(mergedFrom);
+					}
 				}
 
 				foundCache = true;
@@ -353,6 +587,12 @@ void Map::getSpectators(SpectatorVec& list, const Position& centerPos, bool mult
 				cacheResult = true;
 			}
 		}
+
+		if (foundCache) {
+			++spectatorCacheHits;
+		} else {
+			++spectatorCacheMisses;
+		}
 	}
 
 	if (!foundCache) {
@@ -360,24 +600,7 @@ void Map::getSpectators(SpectatorVec& list, const Position& centerPos, bool mult
 		int32_t maxRangeZ;
 
 		if (multifloor) {
-			if (centerPos.z > 7) {
-				//underground
-
-				//8->15
-				minRangeZ = std::max<int32_t>(centerPos.getZ() - 2, 0);
-				maxRangeZ = std::min<int32_t>(centerPos.getZ() + 2, MAP_MAX_LAYERS - 1);
-			}
-			//above ground
-			else if (centerPos.z == 6) {
-				minRangeZ = 0;
-				maxRangeZ = 8;
-			} else if (centerPos.z == 7) {
-				minRangeZ = 0;
-				maxRangeZ = 9;
-			} else {
-				minRangeZ = 0;
-				maxRangeZ = 7;
-			}
+			getViewportFloors(centerPos, minRangeZ, maxRangeZ);
 		} else {
 			minRangeZ = centerPos.z;
 			maxRangeZ = centerPos.z;
@@ -386,11 +609,9 @@ void Map::getSpectators(SpectatorVec& list, const Position& centerPos, bool mult
 		getSpectatorsInternal(list, centerPos, minRangeX, maxRangeX, minRangeY, maxRangeY, minRangeZ, maxRangeZ, onlyPlayers);
 
 		if (cacheResult) {
-			if (onlyPlayers) {
-				playersSpectatorCache[centerPos].reset(new SpectatorVec(list));
-			} else {
-				spectatorCache[centerPos].reset(new SpectatorVec(list));
-			}
+			SpectatorCacheEntry& entry = (onlyPlayers ? playersSpectatorCache[centerPos] : spectatorCache[centerPos]);
+			entry.list = list;
+			entry.version = QTreeLeafNode::versionCounter;
 		}
 	}
 }
@@ -398,32 +619,37 @@ void Map::getSpectators(SpectatorVec& list, const Position& centerPos, bool mult
 const SpectatorVec& Map::getSpectators(const Position& centerPos)
 {
 	if (centerPos.z >= MAP_MAX_LAYERS) {
-		std::shared_ptr<SpectatorVec> p(new SpectatorVec());
-		SpectatorVec& list = *p;
-		return list;
+		emptySpectatorVec.clear();
+		return emptySpectatorVec;
 	}
 
 	auto it = spectatorCache.find(centerPos);
-	if (it != spectatorCache.end()) {
-		return *it->second;
+	if (it != spectatorCache.end() && isSpectatorCacheValid(it->second, centerPos)) {
+		++spectatorCacheHits;
+		return it->second.list;
 	}
 
-	std::shared_ptr<SpectatorVec> p(new SpectatorVec());
-	spectatorCache[centerPos] = p;
-	SpectatorVec& list = *p;
+	++spectatorCacheMisses;
+
+	SpectatorCacheEntry& entry = spectatorCache[centerPos];
+	entry.list.clear();
+	entry.version = QTreeLeafNode::versionCounter;
 
-	int32_t minRangeX = -maxViewportX;
-	int32_t maxRangeX = maxViewportX;
-	int32_t minRangeY = -maxViewportY;
-	int32_t maxRangeY = maxViewportY;
 	int32_t minRangeZ, maxRangeZ;
+	getViewportFloors(centerPos, minRangeZ, maxRangeZ);
 
+	getSpectatorsInternal(entry.list, centerPos, -maxViewportX, maxViewportX, -maxViewportY, maxViewportY, minRangeZ, maxRangeZ, false);
+	return entry.list;
+}
+
+void Map::getViewportFloors(const Position& centerPos, int32_t& minRangeZ, int32_t& maxRangeZ)
+{
 	if (centerPos.z > 7) {
 		//underground
 
 		//8->15
-		minRangeZ = std::max<int32_t>(centerPos.z - 2, 0);
-		maxRangeZ = std::min<int32_t>(centerPos.z + 2, MAP_MAX_LAYERS - 1);
+		minRangeZ = std::max<int32_t>(centerPos.getZ() - 2, 0);
+		maxRangeZ = std::min<int32_t>(centerPos.getZ() + 2, MAP_MAX_LAYERS - 1);
 	}
 	//above ground
 	else if (centerPos.z == 6) {
@@ -436,13 +662,58 @@ const SpectatorVec& Map::getSpectators(const Position& centerPos)
 		minRangeZ = 0;
 		maxRangeZ = 7;
 	}
+}
 
-	getSpectatorsInternal(list, centerPos, minRangeX, maxRangeX, minRangeY, maxRangeY, minRangeZ, maxRangeZ, false);
-	return list;
+bool Map::isSpectatorCacheValid(const SpectatorCacheEntry& entry, const Position& centerPos) const
+{
+	int32_t minRangeZ, maxRangeZ;
+	getViewportFloors(centerPos, minRangeZ, maxRangeZ);
+
+	// same area getSpectatorsInternal scans for the full viewport
+	int32_t minoffset = centerPos.getZ() - maxRangeZ;
+	uint16_t x1 = std::min<uint32_t>(0xFFFF, std::max<int32_t>(0, (centerPos.x - maxViewportX + minoffset)));
+	uint16_t y1 = std::min<uint32_t>(0xFFFF, std::max<int32_t>(0, (centerPos.y - maxViewportY + minoffset)));
+
+	int32_t maxoffset = centerPos.getZ() - minRangeZ;
+	uint16_t x2 = std::min<uint32_t>(0xFFFF, std::max<int32_t>(0, (centerPos.x + maxViewportX + maxoffset)));
+	uint16_t y2 = std::min<uint32_t>(0xFFFF, std::max<int32_t>(0, (centerPos.y + maxViewportY + maxoffset)));
+
+	int32_t startx1 = x1 - (x1 % FLOOR_SIZE);
+	int32_t starty1 = y1 - (y1 % FLOOR_SIZE);
+	int32_t endx2 = x2 - (x2 % FLOOR_SIZE);
+	int32_t endy2 = y2 - (y2 % FLOOR_SIZE);
+
+	const QTreeLeafNode* leafS = QTreeNode::getLeafStatic(&root, startx1, starty1);
+	const QTreeLeafNode* leafE;
+
+	for (int_fast32_t ny = starty1; ny <= endy2; ny += FLOOR_SIZE) {
+		leafE = leafS;
+		for (int_fast32_t nx = startx1; nx <= endx2; nx += FLOOR_SIZE) {
+			if (leafE) {
+				if (leafE->m_version > entry.version) {
+					return false;
+				}
+				leafE = leafE->m_leafE;
+			} else {
+				leafE = QTreeNode::getLeafStatic(&root, nx + FLOOR_SIZE, ny);
+			}
+		}
+
+		if (leafS) {
+			leafS = leafS->m_leafS;
+		} else {
+			leafS = QTreeNode::getLeafStatic(&root, startx1, ny + FLOOR_SIZE);
+		}
+	}
+	return true;
 }
 
-void Map::clearSpectatorCache()
+void Map::trimSpectatorCache()
 {
+	if (spectatorCache.size() + playersSpectatorCache.size() < SPECTATOR_CACHE_MAX_SIZE) {
+		return;
+	}
+
 	spectatorCache.clear();
 	playersSpectatorCache.clear();
 }
@@ -493,6 +764,11 @@ bool Map::checkSightLine(const Position& fromPos, const Position& toPos) const
 	int32_t B = Position::getOffsetX(start, destination);
 	int32_t C = -(A * destination.x + B * destination.y);
 
+	// the floor is only looked up again when the line crosses into another leaf
+	const Floor* floor = nullptr;
+	int32_t floorX = -1;
+	int32_t floorY = -1;
+
 	while (start.x != destination.x || start.y != destination.y) {
 		int32_t move_hor = std::abs(A * (start.x + mx) + B * (start.y) + C);
 		int32_t move_ver = std::abs(A * (start.x) + B * (start.y + my) + C);
@@ -506,15 +782,22 @@ bool Map::checkSightLine(const Position& fromPos, const Position& toPos) const
 			start.x += mx;
 		}
 
-		const Tile* tile = getTile(start.x, start.y, start.z);
-		if (tile && tile->hasProperty(CONST_PROP_BLOCKPROJECTILE)) {
+		if ((start.x & ~FLOOR_MASK) != floorX || (start.y & ~FLOOR_MASK) != floorY) {
+			floorX = start.x & ~FLOOR_MASK;
+			floorY = start.y & ~FLOOR_MASK;
+
+			const QTreeLeafNode* leaf = QTreeNode::getLeafStatic(&root, start.x, start.y);
+			floor = leaf ? leaf->getFloor(start.z) : nullptr;
+		}
+
+		if (floor && (floor->sightBlock & Floor::getSightBit(start.x, start.y)) != 0) {
 			return false;
 		}
 	}
 
 	// now we need to perform a jump between floors to see if everything is clear (literally)
 	while (start.z != destination.z) {
-		const Tile* tile = getTile(start.x, start.y, start.z);
+		const Tile* tile = peekTile(start.x, start.y, start.z);
 		if (tile && tile->getThingCount() > 0) {
 			return false;
 		}
@@ -525,6 +808,26 @@ bool Map::checkSightLine(const Position& fromPos, const Position& toPos) const
 	return true;
 }
 
+void Map::setSightBlock(const Position& pos, bool blocked)
+{
+	QTreeLeafNode* leaf = root.getLeaf(pos.x, pos.y);
+	if (!leaf) {
+		return;
+	}
+
+	Floor* floor = leaf->getFloor(pos.z);
+	if (!floor) {
+		return;
+	}
+
+	if (blocked) {
+		floor->sightBlock |= Floor::getSightBit(pos.x, pos.y);
+	} else {
+		floor->sightBlock &= ~Floor::getSightBit(pos.x, pos.y);
+	}
+	++sightVersion;
+}
+
 bool Map::isSightClear(const Position& fromPos, const Position& toPos, bool floorCheck) const
 {
 	if (floorCheck && fromPos.z != toPos.z) {
@@ -541,11 +844,11 @@ const Tile* Map::canWalkTo(const Creature& creature, const Position& pos) const
 	if (walkCache == 0) {
 		return nullptr;
 	} else if (walkCache == 1) {
-		return getTile(pos.x, pos.y, pos.z);
+		return peekTile(pos.x, pos.y, pos.z);
 	}
 
 	//used for non-cached tiles
-	Tile* tile = getTile(pos.x, pos.y, pos.z);
+	const Tile* tile = peekTile(pos.x, pos.y, pos.z);
 	if (creature.getTile() != tile) {
 		if (!tile || tile->__queryAdd(0, &creature, 1, FLAG_PATHFINDING | FLAG_IGNOREFIELDDAMAGE) != RETURNVALUE_NOERROR) {
 			return nullptr;
@@ -556,7 +859,12 @@ const Tile* Map::canWalkTo(const Creature& creature, const Position& pos) const
 
 bool Map::getPathMatching(const Creature& creature, std::list<Direction>& dirList, const FrozenPathingConditionCall& pathCondition, const FindPathParams& fpp) const
 {
-	Position pos = creature.getPosition();
+	return getPathMatching(creature, creature.getPosition(), dirList, pathCondition, fpp);
+}
+
+bool Map::getPathMatching(const Creature& creature, const Position& startPos, std::list<Direction>& dirList, const FrozenPathingConditionCall& pathCondition, const FindPathParams& fpp) const
+{
+	Position pos = startPos;
 	Position endPos;
 
 	AStarNodes nodes(pos.x, pos.y);
@@ -577,8 +885,6 @@ bool Map::getPathMatching(const Creature& creature, std::list<Direction>& dirLis
 		{-1, 0}, {0, 1}, {1, 0}, {0, -1}, {-1, -1}, {1, -1}, {1, 1}, {-1, 1}
 	};
 
-	const Position startPos = pos;
-
 	AStarNode* found = nullptr;
 	while (fpp.maxSearchDist != 0 || nodes.getClosedNodes() < 100) {
 		AStarNode* n = nodes.getBestNode();
@@ -651,7 +957,7 @@ bool Map::getPathMatching(const Creature& creature, std::list<Direction>& dirLis
 			const Tile* tile;
 			AStarNode* neighborNode = nodes.getNodeByPosition(pos.x, pos.y);
 			if (neighborNode) {
-				tile = getTile(pos.x, pos.y, pos.z);
+				tile = peekTile(pos.x, pos.y, pos.z);
 			} else {
 				tile = canWalkTo(creature, pos);
 				if (!tile) {
@@ -730,21 +1036,272 @@ bool Map::getPathMatching(const Creature& creature, std::list<Direction>& dirLis
 	return true;
 }
 
+bool Map::getSectorPath(const Creature& creature, const Position& targetPos, std::list<Direction>& dirList, const FindPathParams& fpp)
+{
+	std::vector<Position> waypoints;
+	if (!sectorGraph.getPath(*this, creature.getPosition(), targetPos, waypoints)) {
+		return false;
+	}
+
+	// consecutive waypoints are at most a sector apart
+	FindPathParams stepParams;
+	stepParams.fullPathSearch = true;
+	stepParams.clearSight = false;
+	stepParams.allowDiagonal = fpp.allowDiagonal;
+	stepParams.maxSearchDist = SECTOR_SIZE;
+	stepParams.minTargetDist = 0;
+	stepParams.maxTargetDist = 0;
+
+	std::list<Direction> path;
+	Position pos = creature.getPosition();
+	for (const Position& waypoint : waypoints) {
+		std::list<Direction> steps;
+		if (!getPathMatching(creature, pos, steps, FrozenPathingConditionCall(waypoint), stepParams)) {
+			return false;
+		}
+
+		path.splice(path.end(), steps);
+		pos = waypoint;
+	}
+
+	FindPathParams lastParams = fpp;
+	lastParams.maxSearchDist = SECTOR_SIZE * 2;
+
+	std::list<Direction> steps;
+	if (!getPathMatching(creature, pos, steps, FrozenPathingConditionCall(targetPos), lastParams)) {
+		return false;
+	}
+
+	path.splice(path.end(), steps);
+	dirList.splice(dirList.end(), path);
+	return true;
+}
+
+bool Map::getFlowFieldPath(const Creature& creature, const Creature& target, std::list<Direction>& dirList)
+{
+	const Position& targetPos = target.getPosition();
+	Position pos = creature.getPosition();
+	if (pos.z != targetPos.z || Position::getDistanceX(pos, targetPos) > FLOW_FIELD_RADIUS || Position::getDistanceY(pos, targetPos) > FLOW_FIELD_RADIUS) {
+		return false;
+	}
+
+	const FlowField& field = getFlowField(target);
+
+	const int_fast32_t originX = targetPos.x - FLOW_FIELD_RADIUS;
+	const int_fast32_t originY = targetPos.y - FLOW_FIELD_RADIUS;
+
+	// the field may not reach the tile the creature stands on, so the
+	// first step is picked from its neighbors like every other one
+	int_fast32_t current = std::numeric_limits<int32_t>::max();
+	if (Position::getDistanceX(pos, targetPos) <= 1 && Position::getDistanceY(pos, targetPos) <= 1) {
+		current = 0;
+	}
+
+	while (current != 0) {
+		Position bestPos;
+		int_fast32_t best = std::numeric_limits<int32_t>::max();
+		int_fast32_t bestCost = 0;
+		for (int_fast32_t dy = -1; dy <= 1; ++dy) {
+			for (int_fast32_t dx = -1; dx <= 1; ++dx) {
+				if (dx == 0 && dy == 0) {
+					continue;
+				}
+
+				const int_fast32_t fx = pos.x + dx - originX;
+				const int_fast32_t fy = pos.y + dy - originY;
+				if (fx < 0 || fy < 0 || fx >= FLOW_FIELD_SIZE || fy >= FLOW_FIELD_SIZE) {
+					continue;
+				}
+
+				const int_fast32_t cost = field.cost[fy][fx];
+				if (cost >= current) {
+					continue;
+				}
+
+				const int_fast32_t walkCost = (dx != 0 && dy != 0 ? MAP_DIAGONALWALKCOST : MAP_NORMALWALKCOST);
+				if (cost + walkCost < best) {
+					best = cost + walkCost;
+					bestCost = cost;
+					bestPos = Position(pos.x + dx, pos.y + dy, pos.z);
+				}
+			}
+		}
+
+		// the field ignores what is specific to this creature, so every
+		// step is checked the same way getPathMatching would
+		if (best == std::numeric_limits<int32_t>::max() || !canWalkTo(creature, bestPos)) {
+			dirList.clear();
+			return false;
+		}
+
+		dirList.push_back(getDirectionTo(pos, bestPos));
+		pos = bestPos;
+		current = bestCost;
+	}
+	return true;
+}
+
+const FlowField& Map::getFlowField(const Creature& target)
+{
+	const int64_t now = OTSYS_TIME();
+
+	auto it = flowFields.find(target.getID());
+	if (it != flowFields.end()) {
+		FlowField& field = it->second;
+		if (field.targetPos == target.getPosition() && field.expireTime > now) {
+			return field;
+		}
+	} else {
+		if (flowFields.size() >= FLOW_FIELD_MAX_COUNT) {
+			auto oldestIt = flowFields.end();
+			for (auto fieldIt = flowFields.begin(); fieldIt != flowFields.end();) {
+				if (fieldIt->second.expireTime <= now) {
+					fieldIt = flowFields.erase(fieldIt);
+				} else {
+					if (oldestIt == flowFields.end() || fieldIt->second.expireTime < oldestIt->second.expireTime) {
+						oldestIt = fieldIt;
+					}
+					++fieldIt;
+				}
+			}
+
+			// every field is still fresh, give up the one built first
+			if (flowFields.size() >= FLOW_FIELD_MAX_COUNT) {
+				flowFields.erase(oldestIt);
+			}
+		}
+		it = flowFields.emplace(target.getID(), FlowField()).first;
+	}
+
+	FlowField& field = it->second;
+	field.targetPos = target.getPosition();
+	field.expireTime = now + FLOW_FIELD_MAX_AGE;
+	buildFlowField(field);
+	return field;
+}
+
+void Map::removeFlowField(const Creature& target)
+{
+	flowFields.erase(target.getID());
+}
+
+void Map::buildFlowField(FlowField& field) const
+{
+	for (int_fast32_t y = 0; y < FLOW_FIELD_SIZE; ++y) {
+		for (int_fast32_t x = 0; x < FLOW_FIELD_SIZE; ++x) {
+			field.cost[y][x] = std::numeric_limits<int32_t>::max();
+		}
+	}
+
+	const Position& targetPos = field.targetPos;
+	const int_fast32_t originX = targetPos.x - FLOW_FIELD_RADIUS;
+	const int_fast32_t originY = targetPos.y - FLOW_FIELD_RADIUS;
+
+	// reverse Dijkstra, the cost of a tile is what it takes to walk from
+	// it to any walkable tile next to the target
+	typedef std::pair<int32_t, uint16_t> QueueEntry;
+	std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> queue;
+	for (int_fast32_t dy = -1; dy <= 1; ++dy) {
+		for (int_fast32_t dx = -1; dx <= 1; ++dx) {
+			if (dx == 0 && dy == 0) {
+				continue;
+			}
+
+			const Tile* tile = peekTile(targetPos.x + dx, targetPos.y + dy, targetPos.z);
+			if (isFlowFieldWalkable(tile)) {
+				const int_fast32_t fx = FLOW_FIELD_RADIUS + dx;
+				const int_fast32_t fy = FLOW_FIELD_RADIUS + dy;
+				field.cost[fy][fx] = 0;
+				queue.emplace(0, fy * FLOW_FIELD_SIZE + fx);
+			}
+		}
+	}
+
+	while (!queue.empty()) {
+		const int32_t cost = queue.top().first;
+		const int_fast32_t fx = queue.top().second % FLOW_FIELD_SIZE;
+		const int_fast32_t fy = queue.top().second / FLOW_FIELD_SIZE;
+		queue.pop();
+
+		if (cost != field.cost[fy][fx]) {
+			continue;
+		}
+
+		// walking onto this tile costs the same from every neighbor
+		const int32_t tileCost = cost + getFlowFieldTileCost(peekTile(originX + fx, originY + fy, targetPos.z));
+		for (int_fast32_t dy = -1; dy <= 1; ++dy) {
+			for (int_fast32_t dx = -1; dx <= 1; ++dx) {
+				const int_fast32_t nx = fx + dx;
+				const int_fast32_t ny = fy + dy;
+				if ((dx == 0 && dy == 0) || nx < 0 || ny < 0 || nx >= FLOW_FIELD_SIZE || ny >= FLOW_FIELD_SIZE) {
+					continue;
+				}
+
+				const int32_t newCost = tileCost + (dx != 0 && dy != 0 ? MAP_DIAGONALWALKCOST : MAP_NORMALWALKCOST);
+				if (newCost >= field.cost[ny][nx]) {
+					continue;
+				}
+
+				if (!isFlowFieldWalkable(peekTile(originX + nx, originY + ny, targetPos.z))) {
+					continue;
+				}
+
+				field.cost[ny][nx] = newCost;
+				queue.emplace(newCost, ny * FLOW_FIELD_SIZE + nx);
+			}
+		}
+	}
+}
+
+bool Map::isFlowFieldWalkable(const Tile* tile)
+{
+	// what blocks any monster, the rest is left to canWalkTo
+	if (!tile || !tile->ground || tile->floorChange() || tile->positionChange()) {
+		return false;
+	}
+
+	if (tile->hasFlag(TILESTATE_PROTECTIONZONE) || tile->hasFlag(TILESTATE_IMMOVABLEBLOCKSOLID) ||
+	        tile->hasFlag(TILESTATE_IMMOVABLENOFIELDBLOCKPATH) || tile->hasFlag(TILESTATE_BLOCKSOLID) ||
+	        tile->hasFlag(TILESTATE_NOFIELDBLOCKPATH)) {
+		return false;
+	}
+	return true;
+}
+
+int_fast32_t Map::getFlowFieldTileCost(const Tile* tile)
+{
+	// same as AStarNodes::getTileWalkCost without knowing who walks there
+	int_fast32_t cost = 0;
+	if (tile->getTopCreature() != nullptr) {
+		cost += MAP_NORMALWALKCOST * 3;
+	}
+
+	if (tile->getFieldItem()) {
+		cost += MAP_NORMALWALKCOST * 18;
+	}
+	return cost;
+}
+
 //*********** AStarNodes *************
 
 AStarNodes::AStarNodes(uint32_t x, uint32_t y)
-	: openNodes()
+	: nodeGrid()
 {
 	curNode = 1;
 	closedNodes = 0;
-	openNodes[0] = true;
+	gridX = x - NODE_GRID_SIZE / 2;
+	gridY = y - NODE_GRID_SIZE / 2;
 
 	AStarNode& startNode = nodes[0];
 	startNode.parent = nullptr;
 	startNode.x = x;
 	startNode.y = y;
 	startNode.f = 0;
-	nodeTable[(x << 16) | y] = &startNode;
+	nodeGrid[NODE_GRID_SIZE / 2][NODE_GRID_SIZE / 2] = 1;
+
+	openHeap[0] = 0;
+	heapIndex[0] = 0;
+	heapSize = 1;
 }
 
 AStarNode* AStarNodes::createOpenNode(AStarNode* parent, uint32_t x, uint32_t y, int_fast32_t f)
@@ -754,36 +1311,42 @@ AStarNode* AStarNodes::createOpenNode(AStarNode* parent, uint32_t x, uint32_t y,
 	}
 
 	size_t retNode = curNode++;
-	openNodes[retNode] = true;
 
 	AStarNode* node = &nodes[retNode];
-	nodeTable[(x << 16) | y] = node;
 	node->parent = parent;
 	node->x = x;
 	node->y = y;
 	node->f = f;
+
+	uint32_t gx = x - gridX;
+	uint32_t gy = y - gridY;
+	if (gx < NODE_GRID_SIZE && gy < NODE_GRID_SIZE) {
+		nodeGrid[gy][gx] = retNode + 1;
+	} else {
+		nodeTable[(x << 16) | y] = node;
+	}
+
+	openHeap[heapSize] = retNode;
+	heapIndex[retNode] = heapSize;
+	siftUp(heapSize++);
 	return node;
 }
 
 AStarNode* AStarNodes::getBestNode()
 {
-	if (curNode == 0) {
+	if (heapSize == 0) {
 		return nullptr;
 	}
 
-	int32_t best_node_f = std::numeric_limits<int32_t>::max();
-	int32_t best_node = -1;
-	for (uint32_t i = 0; i < curNode; i++) {
-		if (openNodes[i] && nodes[i].f < best_node_f) {
-			best_node_f = nodes[i].f;
-			best_node = i;
-		}
-	}
+	uint16_t best = openHeap[0];
+	heapIndex[best] = -1;
 
-	if (best_node >= 0) {
-		return &nodes[best_node];
+	if (--heapSize != 0) {
+		openHeap[0] = openHeap[heapSize];
+		heapIndex[openHeap[0]] = 0;
+		siftDown(0);
 	}
-	return nullptr;
+	return &nodes[best];
 }
 
 void AStarNodes::closeNode(AStarNode* node)
@@ -794,7 +1357,6 @@ void AStarNodes::closeNode(AStarNode* node)
 		return;
 	}
 
-	openNodes[pos] = false;
 	++closedNodes;
 }
 
@@ -806,10 +1368,16 @@ void AStarNodes::openNode(AStarNode* node)
 		return;
 	}
 
-	if (!openNodes[pos]) {
-		openNodes[pos] = true;
-		--closedNodes;
+	if (heapIndex[pos] >= 0) {
+		// still open, its f only ever decreases
+		siftUp(heapIndex[pos]);
+		return;
 	}
+
+	openHeap[heapSize] = pos;
+	heapIndex[pos] = heapSize;
+	siftUp(heapSize++);
+	--closedNodes;
 }
 
 int_fast32_t AStarNodes::getClosedNodes() const
@@ -819,6 +1387,16 @@ int_fast32_t AStarNodes::getClosedNodes() const
 
 AStarNode* AStarNodes::getNodeByPosition(uint32_t x, uint32_t y)
 {
+	uint32_t gx = x - gridX;
+	uint32_t gy = y - gridY;
+	if (gx < NODE_GRID_SIZE && gy < NODE_GRID_SIZE) {
+		uint16_t index = nodeGrid[gy][gx];
+		if (index == 0) {
+			return nullptr;
+		}
+		return &nodes[index - 1];
+	}
+
 	auto it = nodeTable.find((x << 16) | y);
 	if (it == nodeTable.end()) {
 		return nullptr;
@@ -826,6 +1404,58 @@ AStarNode* AStarNodes::getNodeByPosition(uint32_t x, uint32_t y)
 	return it->second;
 }
 
+bool AStarNodes::isBetter(uint16_t a, uint16_t b) const
+{
+	if (nodes[a].f != nodes[b].f) {
+		return nodes[a].f < nodes[b].f;
+	}
+	return a < b;
+}
+
+void AStarNodes::siftUp(size_t pos)
+{
+	uint16_t index = openHeap[pos];
+	while (pos != 0) {
+		size_t parent = (pos - 1) / 2;
+		if (!isBetter(index, openHeap[parent])) {
+			break;
+		}
+
+		openHeap[pos] = openHeap[parent];
+		heapIndex[openHeap[pos]] = pos;
+		pos = parent;
+	}
+
+	openHeap[pos] = index;
+	heapIndex[index] = pos;
+}
+
+void AStarNodes::siftDown(size_t pos)
+{
+	uint16_t index = openHeap[pos];
+	while (true) {
+		size_t child = pos * 2 + 1;
+		if (child >= heapSize) {
+			break;
+		}
+
+		if (child + 1 < heapSize && isBetter(openHeap[child + 1], openHeap[child])) {
+			++child;
+		}
+
+		if (!isBetter(openHeap[child], index)) {
+			break;
+		}
+
+		openHeap[pos] = openHeap[child];
+		heapIndex[openHeap[pos]] = pos;
+		pos = child;
+	}
+
+	openHeap[pos] = index;
+	heapIndex[index] = pos;
+}
+
 int_fast32_t AStarNodes::getMapWalkCost(AStarNode* node, const Position& neighborPos)
 {
 	if (std::abs(node->x - neighborPos.x) == std::abs(node->y - neighborPos.y)) {
@@ -858,7 +1488,9 @@ Floor::~Floor()
 {
 	for (uint32_t i = 0; i < FLOOR_SIZE; ++i) {
 		for (uint32_t j = 0; j < FLOOR_SIZE; ++j) {
-			delete tiles[i][j];
+			if (!isShared(tiles[i][j])) {
+				delete tiles[i][j];
+			}
 		}
 	}
 }
@@ -927,6 +1559,7 @@ QTreeLeafNode* QTreeNode::createLeaf(uint32_t x, uint32_t y, uint32_t level)
 
 //************ LeafNode ************************
 bool QTreeLeafNode::newLeaf = false;
+uint64_t QTreeLeafNode::versionCounter = 0;
 QTreeLeafNode::QTreeLeafNode()
 {
 	for (uint32_t i = 0; i < MAP_MAX_LAYERS; ++i) {
@@ -936,6 +1569,7 @@ QTreeLeafNode::QTreeLeafNode()
 	m_isLeaf = true;
 	m_leafS = nullptr;
 	m_leafE = nullptr;
+	m_version = 0;
 }
 
 QTreeLeafNode::~QTreeLeafNode()
@@ -955,28 +1589,72 @@ Floor* QTreeLeafNode::createFloor(uint32_t z)
 
 void QTreeLeafNode::addCreature(Creature* c)
 {
-	creature_list.push_back(c);
+	updateVersion();
+	creature_list.add(c);
 
 	if (c->getPlayer()) {
-		player_list.push_back(c);
+		player_list.add(c);
 	}
 }
 
 void QTreeLeafNode::removeCreature(Creature* c)
 {
-	CreatureVector::iterator iter = std::find(creature_list.begin(), creature_list.end(), c);
-	assert(iter != creature_list.end());
-	*iter = creature_list.back();
-	creature_list.pop_back();
+	updateVersion();
+	creature_list.remove(c);
+
+	if (c->getPlayer()) {
+		player_list.remove(c);
+	}
+}
+
+void QTreeLeafNode::updateCreature(Creature* c)
+{
+	updateVersion();
+	creature_list.update(c);
 
 	if (c->getPlayer()) {
-		iter = std::find(player_list.begin(), player_list.end(), c);
-		assert(iter != player_list.end());
-		*iter = player_list.back();
-		player_list.pop_back();
+		player_list.update(c);
 	}
 }
 
+void LeafCreatures::add(Creature* c)
+{
+	const Position& pos = c->getPosition();
+	list.push_back(c);
+	x.push_back(pos.x + pos.z);
+	y.push_back(pos.y + pos.z);
+	z.push_back(pos.z);
+}
+
+void LeafCreatures::remove(Creature* c)
+{
+	CreatureVector::iterator iter = std::find(list.begin(), list.end(), c);
+	assert(iter != list.end());
+
+	size_t index = iter - list.begin();
+	list[index] = list.back();
+	x[index] = x.back();
+	y[index] = y.back();
+	z[index] = z.back();
+
+	list.pop_back();
+	x.pop_back();
+	y.pop_back();
+	z.pop_back();
+}
+
+void LeafCreatures::update(Creature* c)
+{
+	CreatureVector::iterator iter = std::find(list.begin(), list.end(), c);
+	assert(iter != list.end());
+
+	size_t index = iter - list.begin();
+	const Position& pos = c->getPosition();
+	x[index] = pos.x + pos.z;
+	y[index] = pos.y + pos.z;
+	z[index] = pos.z;
+}
+
 uint32_t Map::clean() const
 {
 	uint64_t start = OTSYS_TIME();
@@ -1004,7 +1682,7 @@ uint32_t Map::clean() const
 				for (size_t x = 0; x < FLOOR_SIZE; ++x) {
 					for (size_t y = 0; y < FLOOR_SIZE; ++y) {
 						Tile* tile = floor->tiles[x][y];
-						if (!tile || tile->hasFlag(TILESTATE_PROTECTIONZONE)) {
+						if (!tile || Floor::isShared(tile) || tile->hasFlag(TILESTATE_PROTECTIONZONE)) {
 							continue;
 						}
 
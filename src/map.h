@@ -28,6 +28,7 @@
 
 #include "tools.h"
 #include "tile.h"
+#include "sectorgraph.h"
 
 class Creature;
 class Player;
@@ -47,6 +48,10 @@ struct AStarNode {
 #define MAX_NODES 512
 #define GET_NODE_INDEX(a) (a - &nodes[0])
 
+// nodes around the start position are looked up in a flat grid, the few
+// searches that wander further out fall back to a hash table
+#define NODE_GRID_SIZE 64
+
 #define MAP_NORMALWALKCOST 10
 #define MAP_DIAGONALWALKCOST 25
 
@@ -57,6 +62,8 @@ class AStarNodes
 		~AStarNodes() {}
 
 		AStarNode* createOpenNode(AStarNode* parent, uint32_t x, uint32_t y, int_fast32_t f);
+		// takes the cheapest node off the open list, closeNode counts it
+		// as closed once its neighbors have been looked at
 		AStarNode* getBestNode();
 		void closeNode(AStarNode* node);
 		void openNode(AStarNode* node);
@@ -67,30 +74,113 @@ class AStarNodes
 		static int_fast32_t getTileWalkCost(const Creature& creature, const Tile* tile);
 
 	private:
+		bool isBetter(uint16_t a, uint16_t b) const;
+		void siftUp(size_t pos);
+		void siftDown(size_t pos);
+
 		AStarNode nodes[MAX_NODES];
-		bool openNodes[MAX_NODES];
+
+		// open nodes as a binary heap ordered by f and then by creation, which
+		// picks the same node as scanning all of them in order would
+		uint16_t openHeap[MAX_NODES];
+		int16_t heapIndex[MAX_NODES];
+		size_t heapSize;
+
+		// node index + 1 for the positions around the start, 0 if not seen yet
+		uint16_t nodeGrid[NODE_GRID_SIZE][NODE_GRID_SIZE];
+		uint32_t gridX, gridY;
 		std::unordered_map<uint32_t, AStarNode*> nodeTable;
+
 		size_t curNode;
 		int_fast32_t closedNodes;
 };
 
-typedef std::unordered_set<Creature*> SpectatorVec;
-typedef std::map<Position, std::shared_ptr<SpectatorVec>> SpectatorCache;
+// Walking cost from every tile around a target to a tile next to it, shared
+// by all monsters chasing that target in melee range instead of each one
+// running its own A* search.
+#define FLOW_FIELD_RADIUS 12
+#define FLOW_FIELD_SIZE (FLOW_FIELD_RADIUS * 2 + 1)
+#define FLOW_FIELD_MAX_AGE 1000
+#define FLOW_FIELD_MAX_COUNT 256
+
+struct FlowField {
+	Position targetPos;
+	int64_t expireTime;
+	int32_t cost[FLOW_FIELD_SIZE][FLOW_FIELD_SIZE];
+};
+
+struct SpectatorCacheEntry {
+	SpectatorVec list;
+	uint64_t version;
+};
+
+typedef std::map<Position, SpectatorCacheEntry> SpectatorCache;
 
 #define FLOOR_BITS 3
 #define FLOOR_SIZE (1 << FLOOR_BITS)
 #define FLOOR_MASK (FLOOR_SIZE - 1)
 
+#define SPECTATOR_CACHE_MAX_SIZE 8192
+
 struct Floor {
-	Floor() : tiles() {}
+	Floor() : tiles(), sightBlock(0) {}
 	~Floor();
 
+	static uint64_t getSightBit(uint32_t x, uint32_t y) {
+		return static_cast<uint64_t>(1) << (((x & FLOOR_MASK) << FLOOR_BITS) | (y & FLOOR_MASK));
+	}
+
+	// a slot with the lowest bit set holds an index into Map::sharedTiles
+	// instead of a Tile, Map::getTile replaces it with a real tile
+	static bool isShared(const Tile* tile) {
+		return (reinterpret_cast<uintptr_t>(tile) & 1) != 0;
+	}
+	static uint32_t getSharedIndex(const Tile* tile) {
+		return static_cast<uint32_t>(reinterpret_cast<uintptr_t>(tile) >> 1);
+	}
+	static Tile* makeShared(uint32_t index) {
+		return reinterpret_cast<Tile*>((static_cast<uintptr_t>(index) << 1) | 1);
+	}
+
 	Tile* tiles[FLOOR_SIZE][FLOOR_SIZE];
+
+	// one bit per tile that blocks projectiles, kept in sync by Tile::updateTileFlags
+	uint64_t sightBlock;
 };
 
 class FrozenPathingConditionCall;
 class QTreeLeafNode;
 
+// Ground plus immovable decoration loaded from the map file, without
+// attributes, decay or anything a script could tell apart. Every position
+// with the same items and flags points at one of these until something
+// changes the tile. Readers that only look at flags and items, such as the
+// map description and pathfinding, get the template tile instead.
+struct SharedTile
+{
+	std::vector<uint16_t> itemIds; // ground first, in the order they are added back
+	uint32_t flags;
+	// never placed on the map, its position is the first one it was loaded at
+	std::unique_ptr<Tile> tile;
+};
+
+// The creatures of a leaf along with a copy of their positions, kept as
+// separate arrays in the same order so getSpectatorsInternal can range
+// check several creatures per compare and only touch the ones in range.
+// Upper floors are seen shifted one tile north-west per level, x and y
+// are stored with z added so that shift becomes a plain box test.
+struct LeafCreatures
+{
+	void add(Creature* c);
+	void remove(Creature* c);
+	void update(Creature* c);
+
+	CreatureVector list;
+	std::vector<int32_t> x;
+	std::vector<int32_t> y;
+	std::vector<int32_t> z;
+};
+
 class QTreeNode
 {
 	public:
@@ -126,14 +216,23 @@ class QTreeLeafNode final : public QTreeNode
 
 		void addCreature(Creature* c);
 		void removeCreature(Creature* c);
+		void updateCreature(Creature* c);
+
+		// called whenever a creature enters, leaves or moves inside this leaf,
+		// cached spectator lists covering it are rebuilt on their next use
+		void updateVersion() {
+			m_version = ++versionCounter;
+		}
 
 	protected:
 		static bool newLeaf;
+		static uint64_t versionCounter;
+		uint64_t m_version;
 		QTreeLeafNode* m_leafS;
 		QTreeLeafNode* m_leafE;
 		Floor* m_array[MAP_MAX_LAYERS];
-		CreatureVector creature_list;
-		CreatureVector player_list;
+		LeafCreatures creature_list;
+		LeafCreatures player_list;
 
 		friend class Map;
 		friend class QTreeNode;
@@ -168,10 +267,20 @@ class Map
 		bool saveMap();
 
 		/**
-		  * Get a single tile.
+		  * Get a single tile, a shared tile is replaced by a tile of its own
+		  * first since the caller may change it.
 		  * \returns A pointer to that tile.
 		  */
-		Tile* getTile(int32_t x, int32_t y, int32_t z) const;
+		Tile* getTile(int32_t x, int32_t y, int32_t z);
+
+		/**
+		  * Get a single tile for reading its flags, items and creatures only.
+		  * A shared tile is not replaced, the template tile of its entry is
+		  * returned instead, whose position and items' parent are not the
+		  * ones asked for.
+		  * \returns A pointer to that tile.
+		  */
+		const Tile* peekTile(int32_t x, int32_t y, int32_t z) const;
 
 		uint32_t clean() const;
 
@@ -183,6 +292,18 @@ class Map
 			setTile(pos.x, pos.y, pos.z, newTile);
 		}
 
+		/**
+		  * Set a tile read from the map file, tiles made of plain decoration
+		  * are replaced by a shared entry until getTile is asked for them.
+		  */
+		void setLoadedTile(int32_t x, int32_t y, int32_t z, Tile* newTile);
+
+		/**
+		  * Get the flags of a tile without creating it if it is still shared.
+		  * \returns false if there is no tile or it has no ground
+		  */
+		bool getGroundTileFlags(int32_t x, int32_t y, int32_t z, uint32_t& flags) const;
+
 		/**
 		  * Place a creature on the map
 		  * \param centerPos The position to place the creature
@@ -225,12 +346,77 @@ class Map
 
 		bool getPathMatching(const Creature& creature, std::list<Direction>& dirList,
 		                     const FrozenPathingConditionCall& pathCondition, const FindPathParams& fpp) const;
+		bool getPathMatching(const Creature& creature, const Position& startPos, std::list<Direction>& dirList,
+		                     const FrozenPathingConditionCall& pathCondition, const FindPathParams& fpp) const;
+
+		/**
+		  * Gets a path to a position further away than getPathMatching can
+		  * search, routed over the sector graph and walked out piece by piece.
+		  * \returns false if there is no such route on the same floor
+		  */
+		bool getSectorPath(const Creature& creature, const Position& targetPos, std::list<Direction>& dirList, const FindPathParams& fpp);
+
+		/**
+		  * Called when the walkability of a tile may have changed.
+		  */
+		void invalidateSector(const Position& pos) {
+			sectorGraph.invalidate(pos);
+		}
+
+		/**
+		  * Called when a tile starts or stops blocking projectiles.
+		  */
+		void setSightBlock(const Position& pos, bool blocked);
+
+		/**
+		  * \returns a counter that changes whenever a tile starts or stops
+		  * blocking projectiles, for caches of isSightClear results
+		  */
+		uint32_t getSightVersion() const {
+			return sightVersion;
+		}
+
+		/**
+		  * Gets a path next to a target from the flow field shared by every
+		  * creature chasing it, instead of running a search of our own.
+		  * \returns false if the field does not lead the creature there, the
+		  * caller should fall back to getPathMatching
+		  */
+		bool getFlowFieldPath(const Creature& creature, const Creature& target, std::list<Direction>& dirList);
+
+		/**
+		  * Drops the flow field of a creature that left the map, nobody
+		  * follows it any more so it would only wait for eviction.
+		  */
+		void removeFlowField(const Creature& target);
+
+		uint64_t getSpectatorCacheHits() const {
+			return spectatorCacheHits;
+		}
+		uint64_t getSpectatorCacheMisses() const {
+			return spectatorCacheMisses;
+		}
+		size_t getSharedTileCount() const {
+			return sharedTiles.size();
+		}
+		uint64_t getUnsharedTileCount() const {
+			return unsharedTileCount;
+		}
 
 		std::map<std::string, Position> waypoints;
 
 	protected:
 		SpectatorCache spectatorCache;
 		SpectatorCache playersSpectatorCache;
+		SpectatorVec emptySpectatorVec;
+		std::unordered_map<uint32_t, FlowField> flowFields;
+		SectorGraph sectorGraph;
+		std::vector<SharedTile> sharedTiles;
+		std::map<std::vector<uint16_t>, uint32_t> sharedTileIndex;
+		uint64_t unsharedTileCount;
+		uint64_t spectatorCacheHits;
+		uint64_t spectatorCacheMisses;
+		uint32_t sightVersion;
 
 		QTreeNode root;
 
@@ -245,17 +431,34 @@ class Map
 		                           int32_t minRangeY, int32_t maxRangeY,
 		                           int32_t minRangeZ, int32_t maxRangeZ, bool onlyPlayers) const;
 
+		// Floors seen from centerPos in the client viewport
+		static void getViewportFloors(const Position& centerPos, int32_t& minRangeZ, int32_t& maxRangeZ);
+
+		// A cached list is valid until a creature changes in any leaf it covers
+		bool isSpectatorCacheValid(const SpectatorCacheEntry& entry, const Position& centerPos) const;
+
 		// Use this when a custom spectator vector is needed, this support many
 		// more parameters than the heavily cached version below.
 		void getSpectators(SpectatorVec& list, const Position& centerPos, bool multifloor = false, bool onlyPlayers = false,
 		                   int32_t minRangeX = 0, int32_t maxRangeX = 0,
 		                   int32_t minRangeY = 0, int32_t maxRangeY = 0);
 		// The returned SpectatorVec is a temporary and should not be kept around
-		// Take special heed in that the vector will be destroyed if any function
-		// that calls clearSpectatorCache is called.
+		// Take special heed in that the vector is rebuilt in place when a
+		// creature near centerPos moves and it is queried again.
 		const SpectatorVec& getSpectators(const Position& centerPos);
 
-		void clearSpectatorCache();
+		static bool isShareableTile(const Tile* tile);
+		static bool isShareableItem(const Item* item);
+		static Tile* createSharedTile(const SharedTile& shared, int32_t x, int32_t y, int32_t z);
+
+		const FlowField& getFlowField(const Creature& target);
+		void buildFlowField(FlowField& field) const;
+		static bool isFlowFieldWalkable(const Tile* tile);
+		static int_fast32_t getFlowFieldTileCost(const Tile* tile);
+
+		// Drops all cached lists once there are too many of them, only call
+		// this when no cached list is referenced anymore.
+		void trimSpectatorCache();
 
 		friend class Game;
 		friend class IOMap;
@@ -55,6 +55,8 @@ Monster::Monster(MonsterType* _mtype) :
 {
 	isIdle = true;
 	isMasterInRange = false;
+	attackRangeSightVersion = 0;
+	attackRangeValid = false;
 	mType = _mtype;
 	spawn = nullptr;
 	defaultOutfit = mType->outfit;
@@ -212,6 +214,11 @@ void Monster::onCreatureMove(Creature* creature, const Tile* newTile, const Posi
 {
 	Creature::onCreatureMove(creature, newTile, newPos, oldTile, oldPos, teleport);
 
+	// before the script, which may return early
+	if (creature == this || targetSet.find(creature) != targetSet.end()) {
+		attackRangeValid = false;
+	}
+
 	if (mType->creatureMoveEvent != -1) {
 		// onCreatureMove(self, creature, oldPosition, newPosition)
 		LuaScriptInterface* scriptInterface = mType->scriptInterface;
@@ -342,25 +349,45 @@ void Monster::removeFriend(Creature* creature)
 void Monster::addTarget(Creature* creature, bool pushFront/* = false*/)
 {
 	assert(creature != this);
-	if (std::find(targetList.begin(), targetList.end(), creature) == targetList.end()) {
+	if (targetSet.insert(creature).second) {
 		creature->useThing2();
 		if (pushFront) {
-			targetList.push_front(creature);
+			targetList.insert(targetList.begin(), creature);
 		} else {
 			targetList.push_back(creature);
 		}
+		attackRangeValid = false;
 	}
 }
 
 void Monster::removeTarget(Creature* creature)
 {
-	auto it = std::find(targetList.begin(), targetList.end(), creature);
-	if (it != targetList.end()) {
+	if (targetSet.erase(creature) != 0) {
+		targetList.erase(std::find(targetList.begin(), targetList.end(), creature));
 		creature->releaseThing2();
-		targetList.erase(it);
+		attackRangeValid = false;
 	}
 }
 
+bool Monster::isInAttackRange(Creature* creature)
+{
+	uint32_t sightVersion = g_game.getMap()->getSightVersion();
+	if (!attackRangeValid || attackRangeSightVersion != sightVersion) {
+		attackRangeTargets.clear();
+
+		const Position& myPos = getPosition();
+		for (Creature* target : targetList) {
+			if (canUseAttack(myPos, target)) {
+				attackRangeTargets.insert(target);
+			}
+		}
+
+		attackRangeSightVersion = sightVersion;
+		attackRangeValid = true;
+	}
+	return attackRangeTargets.find(creature) != attackRangeTargets.end();
+}
+
 void Monster::updateTargetList()
 {
 	auto friendIterator = friendList.begin();
@@ -378,16 +405,25 @@ void Monster::updateTargetList()
 	while (targetIterator != targetList.end()) {
 		Creature* creature = *targetIterator;
 		if (creature->getHealth() <= 0 || !canSee(creature->getPosition())) {
+			targetSet.erase(creature);
 			creature->releaseThing2();
 			targetIterator = targetList.erase(targetIterator);
+			attackRangeValid = false;
 		} else {
 			++targetIterator;
 		}
 	}
 
+	// the callers update the idle status once we are done
 	for (Creature* spectator : g_game.getSpectators(getPosition())) {
 		if (spectator != this && canSee(spectator->getPosition())) {
-			onCreatureFound(spectator);
+			if (isFriend(spectator)) {
+				addFriend(spectator);
+			}
+
+			if (isOpponent(spectator)) {
+				addTarget(spectator);
+			}
 		}
 	}
 }
@@ -398,6 +434,8 @@ void Monster::clearTargetList()
 		creature->releaseThing2();
 	}
 	targetList.clear();
+	targetSet.clear();
+	attackRangeValid = false;
 }
 
 void Monster::clearFriendList()
@@ -502,12 +540,14 @@ void Monster::onCreatureLeave(Creature* creature)
 
 bool Monster::searchTarget(TargetSearchType_t searchType /*= TARGETSEARCH_DEFAULT*/)
 {
-	std::list<Creature*> resultList;
+	std::vector<Creature*> resultList;
+	resultList.reserve(targetList.size());
+
 	const Position& myPos = getPosition();
 
 	for (Creature* creature : targetList) {
 		if (followCreature != creature && isTarget(creature)) {
-			if (searchType == TARGETSEARCH_RANDOM || canUseAttack(myPos, creature)) {
+			if (searchType == TARGETSEARCH_RANDOM || isInAttackRange(creature)) {
 				resultList.push_back(creature);
 			}
 		}
@@ -576,11 +616,13 @@ void Monster::onFollowCreatureComplete(const Creature* creature)
 			targetList.erase(it);
 
 			if (hasFollowPath) {
-				targetList.push_front(target);
+				targetList.insert(targetList.begin(), target);
 			} else if (!isSummon()) {
 				targetList.push_back(target);
 			} else {
+				targetSet.erase(target);
 				target->releaseThing2();
+				attackRangeValid = false;
 			}
 		}
 	}
@@ -630,8 +672,7 @@ bool Monster::selectTarget(Creature* creature)
 		return false;
 	}
 
-	auto it = std::find(targetList.begin(), targetList.end(), creature);
-	if (it == targetList.end()) {
+	if (targetSet.find(creature) == targetSet.end()) {
 		//Target not found in our target list.
 		return false;
 	}
@@ -673,12 +714,33 @@ void Monster::updateIdleStatus()
 			}
 		} else if (targetList.empty()) {
 			idle = true;
+		} else if (!hasReachableTarget()) {
+			// keep the targets and the damage map, their next move onto our
+			// floor or out of a protection zone wakes us up through
+			// onCreatureMove, unlike setIdle(true) which would forget them
+			if (!isIdle && !isRemoved() && getHealth() > 0) {
+				isIdle = true;
+				setFollowCreature(nullptr);
+				setAttackedCreature(nullptr);
+				Game::removeCreatureCheck(this);
+			}
+			return;
 		}
 	}
 
 	setIdle(idle);
 }
 
+bool Monster::hasReachableTarget() const
+{
+	for (Creature* creature : targetList) {
+		if (isTarget(creature)) {
+			return true;
+		}
+	}
+	return false;
+}
+
 void Monster::onAddCondition(ConditionType_t type)
 {
 	if (type == CONDITION_FIRE || type == CONDITION_ENERGY || type == CONDITION_POISON) {
@@ -1782,7 +1844,7 @@ bool Monster::canWalkTo(Position pos, Direction dir) const
 			return false;
 		}
 
-		Tile* tile = g_game.getTile(pos.x, pos.y, pos.z);
+		const Tile* tile = g_game.peekTile(pos.x, pos.y, pos.z);
 		if (tile && tile->getTopVisibleCreature(this) == nullptr && tile->__queryAdd(0, this, 1, FLAG_PATHFINDING) == RETURNVALUE_NOERROR) {
 			return true;
 		}
@@ -28,7 +28,7 @@ class Game;
 class Spawn;
 
 typedef std::unordered_set<Creature*> CreatureHashSet;
-typedef std::list<Creature*> CreatureList;
+typedef std::vector<Creature*> CreatureList;
 
 enum TargetSearchType_t {
 	TARGETSEARCH_DEFAULT,
@@ -160,6 +160,9 @@ class Monster final : public Creature
 			return friendList;
 		}
 
+		bool getIdleStatus() const {
+			return isIdle;
+		}
 		bool isTarget(const Creature* creature) const;
 		bool isFleeing() const {
 			return getHealth() <= mType->runAwayHealth;
@@ -178,6 +181,13 @@ class Monster final : public Creature
 	private:
 		CreatureHashSet friendList;
 		CreatureList targetList;
+		CreatureHashSet targetSet;
+
+		// the targets canUseAttack holds for, valid until we or one of them
+		// moves, the target list changes or a tile changes blocking sight
+		CreatureHashSet attackRangeTargets;
+		uint32_t attackRangeSightVersion;
+		bool attackRangeValid;
 
 		std::string strDescription;
 
@@ -213,6 +223,7 @@ class Monster final : public Creature
 		void removeFriend(Creature* creature);
 		void addTarget(Creature* creature, bool pushFront = false);
 		void removeTarget(Creature* creature);
+		bool isInAttackRange(Creature* creature);
 
 		void updateTargetList();
 		void clearTargetList();
@@ -225,9 +236,7 @@ class Monster final : public Creature
 
 		void setIdle(bool _idle);
 		void updateIdleStatus();
-		bool getIdleStatus() const {
-			return isIdle;
-		}
+		bool hasReachableTarget() const;
 
 		void onAddCondition(ConditionType_t type) final;
 		void onEndCondition(ConditionType_t type) final;
@@ -22,6 +22,9 @@
 #include "outputmessage.h"
 #include "protocol.h"
 #include "scheduler.h"
+#include "configmanager.h"
+
+extern ConfigManager g_config;
 
 OutputMessage::OutputMessage()
 {
@@ -31,10 +34,11 @@ OutputMessage::OutputMessage()
 //*********** OutputMessagePool ****************//
 
 OutputMessagePool::OutputMessagePool()
+	: m_sharedMessageCount(0), m_poolHits(0), m_poolMisses(0), m_outstandingMessages(0)
 {
+	m_dispatcherMessages.reserve(OUTPUT_POOL_SIZE);
 	for (uint32_t i = 0; i < OUTPUT_POOL_SIZE; ++i) {
-		OutputMessage* msg = new OutputMessage();
-		m_outputMessages.push_back(msg);
+		m_dispatcherMessages.push_back(new OutputMessage());
 	}
 
 	m_frameTime = OTSYS_TIME();
@@ -43,70 +47,71 @@ OutputMessagePool::OutputMessagePool()
 
 void OutputMessagePool::startExecutionFrame()
 {
-	//std::lock_guard<std::recursive_mutex> lockClass(m_outputPoolLock);
 	m_frameTime = OTSYS_TIME();
 }
 
 OutputMessagePool::~OutputMessagePool()
 {
-	for (OutputMessage* msg : m_outputMessages) {
+	for (OutputMessage* msg : m_dispatcherMessages) {
+		delete msg;
+	}
+
+	for (OutputMessage* msg : m_sharedMessages) {
 		delete msg;
 	}
 }
 
 void OutputMessagePool::send(OutputMessage_ptr msg)
 {
-	m_outputPoolLock.lock();
-	OutputMessage::OutputMessageState state = msg->getState();
-	m_outputPoolLock.unlock();
-
-	if (state == OutputMessage::STATE_ALLOCATED_NO_AUTOSEND) {
+	if (msg->getState() == OutputMessage::STATE_ALLOCATED_NO_AUTOSEND) {
 		Connection_ptr connection = msg->getConnection();
-		if (connection && !connection->send(msg)) {
-			// Send only fails when connection is closing (or in error state)
-			// This call will free the message
-			msg->getProtocol()->onSendMessage(msg);
+		if (connection) {
+			if (connection->send(msg)) {
+				connection->flush();
+			} else {
+				// Send only fails when connection is closing (or in error state)
+				// This call will free the message
+				msg->getProtocol()->onSendMessage(msg);
+			}
 		}
 	}
 }
 
 void OutputMessagePool::sendAll()
 {
-	std::lock_guard<std::recursive_mutex> lockClass(m_outputPoolLock);
-
-	const int64_t dropTime = m_frameTime - 10000;
+	// with the frame policy every autosend message written during this frame
+	// is queued on its connection, otherwise a message is held back for up to
+	// 10 ms unless it already carries the configured amount of data
+	const bool flushFrame = g_config.getBoolean(ConfigManager::OUTPUT_FLUSH_FRAME);
+	const int32_t flushThreshold = g_config.getNumber(ConfigManager::OUTPUT_FLUSH_THRESHOLD);
 	const int64_t frameTime = m_frameTime - 10;
 
-	for (OutputMessage_ptr omsg : m_toAddQueue) {
-		const int64_t msgFrame = omsg->getFrame();
-		if (msgFrame >= dropTime) {
-			omsg->setState(OutputMessage::STATE_ALLOCATED);
+	size_t keep = 0;
+	for (size_t i = 0, size = m_autoSendOutputMessages.size(); i < size; ++i) {
+		OutputMessage_ptr omsg = m_autoSendOutputMessages[i];
+		if (!flushFrame && frameTime <= omsg->getFrame() && omsg->getMessageLength() < flushThreshold) {
+			m_autoSendOutputMessages[keep++] = omsg;
+			continue;
+		}
 
-			if (frameTime > msgFrame) {
-				m_autoSendOutputMessages.push_front(omsg);
+		Connection_ptr connection = omsg->getConnection();
+		if (connection) {
+			if (connection->send(omsg)) {
+				m_flushConnections.push_back(connection);
 			} else {
-				m_autoSendOutputMessages.push_back(omsg);
+				// Send only fails when connection is closing (or in error state)
+				// This call will free the message
+				omsg->getProtocol()->onSendMessage(omsg);
 			}
-		} else {
-			//drop messages that are older than 10 seconds
-			omsg->getProtocol()->onSendMessage(omsg);
 		}
 	}
-	m_toAddQueue.clear();
+	m_autoSendOutputMessages.resize(keep);
 
-	for (auto it = m_autoSendOutputMessages.begin(), end = m_autoSendOutputMessages.end(); it != end; it = m_autoSendOutputMessages.erase(it)) {
-		OutputMessage_ptr omsg = *it;
-		if (frameTime <= omsg->getFrame()) {
-			break;
-		}
-
-		Connection_ptr connection = omsg->getConnection();
-		if (connection && !connection->send(omsg)) {
-			// Send only fails when connection is closing (or in error state)
-			// This call will free the message
-			omsg->getProtocol()->onSendMessage(omsg);
-		}
+	// one gathered write per connection for everything queued this frame
+	for (const Connection_ptr& connection : m_flushConnections) {
+		connection->flush();
 	}
+	m_flushConnections.clear();
 }
 
 void OutputMessagePool::releaseMessage(OutputMessage* msg)
@@ -130,10 +135,16 @@ void OutputMessagePool::internalReleaseMessage(OutputMessage* msg)
 	}
 
 	msg->freeMessage();
+	--m_outstandingMessages;
 
-	m_outputPoolLock.lock();
-	m_outputMessages.push_back(msg);
-	m_outputPoolLock.unlock();
+	if (m_sharedMessageCount < OUTPUT_POOL_SHARED_SIZE) {
+		m_sharedMessagesLock.lock();
+		m_sharedMessages.push_back(msg);
+		++m_sharedMessageCount;
+		m_sharedMessagesLock.unlock();
+	} else {
+		m_dispatcherMessages.push_back(msg);
+	}
 }
 
 OutputMessage_ptr OutputMessagePool::getOutputMessage(Protocol* protocol, bool autosend /*= true*/)
@@ -142,22 +153,36 @@ OutputMessage_ptr OutputMessagePool::getOutputMessage(Protocol* protocol, bool a
 		return OutputMessage_ptr();
 	}
 
-	std::lock_guard<std::recursive_mutex> lockClass(m_outputPoolLock);
-
 	if (!protocol->getConnection()) {
 		return OutputMessage_ptr();
 	}
 
-	if (m_outputMessages.empty()) {
-		OutputMessage* msg = new OutputMessage();
-		m_outputMessages.push_back(msg);
+	OutputMessage* msg = nullptr;
+	if (g_dispatcher.isDispatcherThread()) {
+		if (!m_dispatcherMessages.empty()) {
+			msg = m_dispatcherMessages.back();
+			m_dispatcherMessages.pop_back();
+		}
+	} else {
+		m_sharedMessagesLock.lock();
+		if (!m_sharedMessages.empty()) {
+			msg = m_sharedMessages.back();
+			m_sharedMessages.pop_back();
+			--m_sharedMessageCount;
+		}
+		m_sharedMessagesLock.unlock();
 	}
 
-	OutputMessage_ptr outputmessage;
-	outputmessage.reset(m_outputMessages.back(),
-	                    std::bind(&OutputMessagePool::releaseMessage, this, std::placeholders::_1));
+	if (msg) {
+		++m_poolHits;
+	} else {
+		++m_poolMisses;
+		msg = new OutputMessage();
+	}
+	++m_outstandingMessages;
 
-	m_outputMessages.pop_back();
+	OutputMessage_ptr outputmessage;
+	outputmessage.reset(msg, std::bind(&OutputMessagePool::releaseMessage, this, std::placeholders::_1));
 
 	configureOutputMessage(outputmessage, protocol, autosend);
 	return outputmessage;
@@ -177,6 +202,8 @@ void OutputMessagePool::configureOutputMessage(OutputMessage_ptr msg, Protocol*
 	Connection_ptr connection = protocol->getConnection();
 	assert(connection);
 
+	// messages without autosend are also built on the network threads, the
+	// reference counts are atomic since the dispatcher releases them
 	msg->setProtocol(protocol);
 	protocol->addRef();
 
@@ -185,10 +212,3 @@ void OutputMessagePool::configureOutputMessage(OutputMessage_ptr msg, Protocol*
 
 	msg->setFrame(m_frameTime);
 }
-
-void OutputMessagePool::addToAutoSend(OutputMessage_ptr msg)
-{
-	m_outputPoolLock.lock();
-	m_toAddQueue.push_back(msg);
-	m_outputPoolLock.unlock();
-}
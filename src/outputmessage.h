@@ -24,9 +24,12 @@
 #include "connection.h"
 #include "tools.h"
 
+#include <atomic>
+
 class Protocol;
 
 #define OUTPUT_POOL_SIZE 100
+#define OUTPUT_POOL_SHARED_SIZE 16
 
 class OutputMessage : public NetworkMessage
 {
@@ -172,30 +175,38 @@ class OutputMessagePool
 			return m_frameTime;
 		}
 
-		size_t getTotalMessageCount() const {
-			return m_allOutputMessages.size();
+		uint64_t getPoolHits() const {
+			return m_poolHits;
 		}
-		size_t getAvailableMessageCount() const {
-			return m_outputMessages.size();
+		uint64_t getPoolMisses() const {
+			return m_poolMisses;
 		}
-		size_t getAutoMessageCount() const {
-			return m_autoSendOutputMessages.size();
+		int64_t getOutstandingMessages() const {
+			return m_outstandingMessages;
 		}
-		void addToAutoSend(OutputMessage_ptr msg);
 
 	protected:
 		void configureOutputMessage(OutputMessage_ptr msg, Protocol* protocol, bool autosend);
 		void releaseMessage(OutputMessage* msg);
 		void internalReleaseMessage(OutputMessage* msg);
 
-		typedef std::list<OutputMessage*> InternalOutputMessageList;
-		typedef std::list<OutputMessage_ptr> OutputMessageMessageList;
-
-		InternalOutputMessageList m_outputMessages;
-		InternalOutputMessageList m_allOutputMessages;
-		OutputMessageMessageList m_autoSendOutputMessages;
-		OutputMessageMessageList m_toAddQueue;
-		std::recursive_mutex m_outputPoolLock;
+		// Messages are always released on the dispatcher thread and nearly all
+		// of them are allocated there too, so the dispatcher keeps a free list
+		// of its own. Other threads (login and status replies) take from a
+		// small shared list that the dispatcher keeps topped up.
+		std::vector<OutputMessage*> m_dispatcherMessages;
+		std::vector<OutputMessage*> m_sharedMessages;
+		std::mutex m_sharedMessagesLock;
+		std::atomic<size_t> m_sharedMessageCount;
+
+		// autosend messages are only created and sent by the dispatcher
+		// thread, these need no locking at all
+		std::vector<OutputMessage_ptr> m_autoSendOutputMessages;
+		std::vector<Connection_ptr> m_flushConnections;
+
+		std::atomic<uint64_t> m_poolHits;
+		std::atomic<uint64_t> m_poolMisses;
+		std::atomic<int64_t> m_outstandingMessages;
 		int64_t m_frameTime;
 		bool m_open;
 };
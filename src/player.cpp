@@ -34,6 +34,7 @@
 #include "player.h"
 #include "quests.h"
 #include "scheduler.h"
+#include "spawn.h"
 #include "town.h"
 #include "weapons.h"
 
@@ -1341,6 +1342,8 @@ void Player::onCreatureDisappear(Creature* creature, uint32_t stackpos, bool isL
 
 		lastLogout = time(nullptr);
 
+		Spawns::getInstance()->onPlayerLeave(getPosition());
+
 		if (eventWalk != 0) {
 			setFollowCreature(nullptr);
 		}
@@ -1432,6 +1435,8 @@ void Player::onCreatureMove(Creature* creature, const Tile* newTile, const Posit
 		return;
 	}
 
+	Spawns::getInstance()->onPlayerMove(oldPos, newPos);
+
 	if (tradeState != TRADE_TRANSFER) {
 		//check if we should close trade
 		if (tradeItem && !Position::areInRange<1, 1, 0>(tradeItem->getPosition(), getPosition())) {
@@ -24,23 +24,27 @@
 #include "connection.h"
 #include "outputmessage.h"
 #include "rsa.h"
+#include "xtea.h"
 
 extern RSA g_RSA;
 
 void Protocol::onSendMessage(OutputMessage_ptr msg)
+{
+	if (msg == m_outputBuffer) {
+		m_outputBuffer.reset();
+	}
+}
+
+void Protocol::prepareMessage(OutputMessage& msg) const
 {
 	if (!m_rawMessages) {
-		msg->writeMessageLength();
+		msg.writeMessageLength();
 
 		if (m_encryptionEnabled) {
-			XTEA_encrypt(*msg);
-			msg->addCryptoHeader(m_checksumEnabled);
+			XTEA_encrypt(msg);
+			msg.addCryptoHeader(m_checksumEnabled);
 		}
 	}
-
-	if (msg == m_outputBuffer) {
-		m_outputBuffer.reset();
-	}
 }
 
 void Protocol::onRecvMessage(NetworkMessage& msg)
@@ -84,8 +88,6 @@ void Protocol::deleteProtocolTask()
 
 void Protocol::XTEA_encrypt(OutputMessage& msg) const
 {
-	const uint32_t delta = 0x61C88647;
-
 	// the message must be a multiple of 8
 	size_t paddingBytes = msg.getMessageLength() & 7;
 	if (paddingBytes != 0) {
@@ -93,22 +95,7 @@ void Protocol::XTEA_encrypt(OutputMessage& msg) const
 	}
 
 	uint32_t* buffer = reinterpret_cast<uint32_t*>(msg.getOutputBuffer());
-	const size_t messageLength = msg.getMessageLength() / 4;
-	size_t readPos = 0;
-	const uint32_t k[] = {m_key[0], m_key[1], m_key[2], m_key[3]};
-	while (readPos < messageLength) {
-		uint32_t v0 = buffer[readPos], v1 = buffer[readPos + 1];
-		uint32_t sum = 0;
-
-		for (int32_t i = 32; --i >= 0;) {
-			v0 += ((v1 << 4 ^ v1 >> 5) + v1) ^ (sum + k[sum & 3]);
-			sum -= delta;
-			v1 += ((v0 << 4 ^ v0 >> 5) + v0) ^ (sum + k[(sum >> 11) & 3]);
-		}
-
-		buffer[readPos++] = v0;
-		buffer[readPos++] = v1;
-	}
+	xteaEncrypt(buffer, msg.getMessageLength() / 8, m_key);
 }
 
 bool Protocol::XTEA_decrypt(NetworkMessage& msg) const
@@ -117,25 +104,8 @@ bool Protocol::XTEA_decrypt(NetworkMessage& msg) const
 		return false;
 	}
 
-	const uint32_t delta = 0x61C88647;
-
 	uint32_t* buffer = reinterpret_cast<uint32_t*>(msg.getBuffer() + msg.getReadPos());
-	const size_t messageLength = (msg.getMessageLength() - 6) / 4;
-	size_t readPos = 0;
-	const uint32_t k[] = {m_key[0], m_key[1], m_key[2], m_key[3]};
-	while (readPos < messageLength) {
-		uint32_t v0 = buffer[readPos], v1 = buffer[readPos + 1];
-		uint32_t sum = 0xC6EF3720;
-
-		for (int32_t i = 32; --i >= 0;) {
-			v1 -= ((v0 << 4 ^ v0 >> 5) + v0) ^ (sum + k[(sum >> 11) & 3]);
-			sum += delta;
-			v0 -= ((v1 << 4 ^ v1 >> 5) + v1) ^ (sum + k[sum & 3]);
-		}
-
-		buffer[readPos++] = v0;
-		buffer[readPos++] = v1;
-	}
+	xteaDecrypt(buffer, (msg.getMessageLength() - 6) / 8, m_key);
 
 	//
 
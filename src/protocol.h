@@ -20,6 +20,8 @@
 #ifndef FS_PROTOCOL_H_D71405071ACF4137A4B1203899DE80E1
 #define FS_PROTOCOL_H_D71405071ACF4137A4B1203899DE80E1
 
+#include <atomic>
+
 class NetworkMessage;
 class OutputMessage;
 class Connection;
@@ -30,7 +32,7 @@ class RSA;
 class Protocol
 {
 	public:
-		Protocol(Connection_ptr connection) : m_connection(connection), m_key(), m_refCount(), m_encryptionEnabled(false), m_checksumEnabled(true), m_rawMessages(false) {}
+		Protocol(Connection_ptr connection) : m_connection(connection), m_key(), m_refCount(0), m_encryptionEnabled(false), m_checksumEnabled(true), m_rawMessages(false) {}
 
 		// non-copyable
 		Protocol(const Protocol&) = delete;
@@ -81,6 +83,10 @@ class Protocol
 			m_checksumEnabled = false;
 		}
 
+		// network thread: adds the length, encryption and checksum framing
+		// right before the message is written to the socket
+		void prepareMessage(OutputMessage& msg) const;
+
 		void XTEA_encrypt(OutputMessage& msg) const;
 		bool XTEA_decrypt(NetworkMessage& msg) const;
 		bool RSA_decrypt(NetworkMessage& msg);
@@ -98,7 +104,8 @@ class Protocol
 	private:
 		Connection_ptr m_connection;
 		uint32_t m_key[4];
-		uint32_t m_refCount;
+		// see Connection::m_refCount
+		std::atomic<uint32_t> m_refCount;
 		bool m_encryptionEnabled;
 		bool m_checksumEnabled;
 		bool m_rawMessages;
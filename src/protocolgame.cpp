@@ -110,6 +110,16 @@ void ProtocolGame::deleteProtocolTask()
 void ProtocolGame::login(const std::string& name, uint32_t accountId, OperatingSystem_t operatingSystem)
 {
 	//dispatcher thread
+	// output buffers belong to the dispatcher, so this is not written
+	// from onRecvFirstMessage on the network thread
+	if (operatingSystem >= CLIENTOS_OTCLIENT_LINUX) {
+		NetworkMessage opcodeMessage;
+		opcodeMessage.AddByte(0x32);
+		opcodeMessage.AddByte(0x00);
+		opcodeMessage.add<uint16_t>(0x00);
+		writeToOutputBuffer(opcodeMessage);
+	}
+
 	Player* _player = g_game.getPlayerByName(name);
 	if (!_player || g_config.getBoolean(ConfigManager::ALLOW_CLONES)) {
 		player = new Player(this);
@@ -318,14 +328,6 @@ void ProtocolGame::onRecvFirstMessage(NetworkMessage& msg)
 	enableXTEAEncryption();
 	setXTEAKey(key);
 
-	if (operatingSystem >= CLIENTOS_OTCLIENT_LINUX) {
-		NetworkMessage opcodeMessage;
-		opcodeMessage.AddByte(0x32);
-		opcodeMessage.AddByte(0x00);
-		opcodeMessage.add<uint16_t>(0x00);
-		writeToOutputBuffer(opcodeMessage);
-	}
-
 	msg.SkipBytes(1); // gamemaster flag
 	std::string accountName = msg.GetString();
 	std::string characterName = msg.GetString();
@@ -643,7 +645,7 @@ void ProtocolGame::GetFloorDescription(NetworkMessage& msg, int32_t x, int32_t y
 {
 	for (int32_t nx = 0; nx < width; nx++) {
 		for (int32_t ny = 0; ny < height; ny++) {
-			Tile* tile = g_game.getTile(x + nx + offset, y + ny + offset, z);
+			const Tile* tile = g_game.peekTile(x + nx + offset, y + ny + offset, z);
 			if (tile) {
 				if (skip >= 0) {
 					msg.AddByte(skip);
@@ -32,6 +32,7 @@ extern ConfigManager g_config;
 extern Game g_game;
 
 std::map<uint32_t, int64_t> ProtocolStatus::ipConnectMap;
+std::mutex ProtocolStatus::ipConnectMapLock;
 const uint64_t ProtocolStatus::start = OTSYS_TIME();
 
 enum RequestedInfo_t {
@@ -48,12 +49,16 @@ enum RequestedInfo_t {
 void ProtocolStatus::onRecvFirstMessage(NetworkMessage& msg)
 {
 	uint32_t ip = getIP();
+
+	// status requests are handled on any of the network threads
+	ipConnectMapLock.lock();
 	if (ip != 0x0100007F) {
 		std::string ipStr = convertIPToString(ip);
 		if (ipStr != g_config.getString(ConfigManager::IP)) {
 			std::map<uint32_t, int64_t>::const_iterator it = ipConnectMap.find(ip);
 			if (it != ipConnectMap.end()) {
 				if (OTSYS_TIME() < (it->second + g_config.getNumber(ConfigManager::STATUSQUERY_TIMEOUT))) {
+					ipConnectMapLock.unlock();
 					getConnection()->closeConnection();
 					return;
 				}
@@ -62,6 +67,7 @@ void ProtocolStatus::onRecvFirstMessage(NetworkMessage& msg)
 	}
 
 	ipConnectMap[ip] = OTSYS_TIME();
+	ipConnectMapLock.unlock();
 
 	switch (msg.GetByte()) {
 		//XML info protocol
@@ -24,22 +24,26 @@
 RSA::RSA()
 {
 	mpz_init(m_n);
-	mpz_init2(m_d, 1024);
+	mpz_init2(m_p, 512);
+	mpz_init2(m_q, 512);
+	mpz_init2(m_dp, 512);
+	mpz_init2(m_dq, 512);
+	mpz_init2(m_qinv, 512);
 }
 
 RSA::~RSA()
 {
 	mpz_clear(m_n);
-	mpz_clear(m_d);
+	mpz_clear(m_p);
+	mpz_clear(m_q);
+	mpz_clear(m_dp);
+	mpz_clear(m_dq);
+	mpz_clear(m_qinv);
 }
 
 void RSA::setKey(const char* p, const char* q)
 {
-	std::lock_guard<std::recursive_mutex> lockClass(lock);
-
-	mpz_t m_p, m_q, m_e;
-	mpz_init2(m_p, 1024);
-	mpz_init2(m_q, 1024);
+	mpz_t m_e;
 	mpz_init(m_e);
 
 	mpz_set_str(m_p, p, 10);
@@ -51,47 +55,56 @@ void RSA::setKey(const char* p, const char* q)
 	// n = p * q
 	mpz_mul(m_n, m_p, m_q);
 
-	// d = e^-1 mod (p - 1)(q - 1)
-	mpz_t p_1, q_1, pq_1;
-	mpz_init2(p_1, 1024);
-	mpz_init2(q_1, 1024);
-	mpz_init2(pq_1, 1024);
+	mpz_t p_1, q_1;
+	mpz_init2(p_1, 512);
+	mpz_init2(q_1, 512);
 
 	mpz_sub_ui(p_1, m_p, 1);
 	mpz_sub_ui(q_1, m_q, 1);
 
-	// pq_1 = (p -1)(q - 1)
-	mpz_mul(pq_1, p_1, q_1);
+	// dp = e^-1 mod (p - 1), dq = e^-1 mod (q - 1)
+	mpz_invert(m_dp, m_e, p_1);
+	mpz_invert(m_dq, m_e, q_1);
 
-	// m_d = m_e^-1 mod (p - 1)(q - 1)
-	mpz_invert(m_d, m_e, pq_1);
+	// qinv = q^-1 mod p
+	mpz_invert(m_qinv, m_q, m_p);
 
 	mpz_clear(p_1);
 	mpz_clear(q_1);
-	mpz_clear(pq_1);
 
-	mpz_clear(m_p);
-	mpz_clear(m_q);
 	mpz_clear(m_e);
 }
 
 void RSA::decrypt(char* msg)
 {
-	std::lock_guard<std::recursive_mutex> lockClass(lock);
-
-	mpz_t c, m;
+	mpz_t c, m1, m2, h;
 	mpz_init2(c, 1024);
-	mpz_init2(m, 1024);
+	mpz_init2(m1, 1024);
+	mpz_init2(m2, 1024);
+	mpz_init2(h, 1024);
 
 	mpz_import(c, 128, 1, 1, 0, 0, msg);
 
-	// m = c^d mod n
-	mpz_powm(m, c, m_d, m_n);
+	// CRT: two half-size exponentiations instead of c^d mod n
+	// m1 = c^dp mod p, m2 = c^dq mod q
+	mpz_powm(m1, c, m_dp, m_p);
+	mpz_powm(m2, c, m_dq, m_q);
+
+	// h = qinv * (m1 - m2) mod p
+	mpz_sub(h, m1, m2);
+	mpz_mul(h, h, m_qinv);
+	mpz_mod(h, h, m_p);
+
+	// m = m2 + h * q
+	mpz_mul(h, h, m_q);
+	mpz_add(m1, m2, h);
 
-	size_t count = (mpz_sizeinbase(m, 2) + 7)/8;
+	size_t count = (mpz_sizeinbase(m1, 2) + 7)/8;
 	memset(msg, 0, 128 - count);
-	mpz_export(&msg[128 - count], nullptr, 1, 1, 0, 0, m);
+	mpz_export(&msg[128 - count], nullptr, 1, 1, 0, 0, m1);
 
 	mpz_clear(c);
-	mpz_clear(m);
+	mpz_clear(m1);
+	mpz_clear(m2);
+	mpz_clear(h);
 }
@@ -32,10 +32,10 @@ class RSA
 		void decrypt(char* msg);
 
 	protected:
-		std::recursive_mutex lock;
-
 		//use only GMP
-		mpz_t m_n, m_d;
+		// the key is set once at startup and only read afterwards, so
+		// decrypt needs no lock and runs in parallel on the network threads
+		mpz_t m_n, m_p, m_q, m_dp, m_dq, m_qinv;
 };
 
 #endif
@@ -21,9 +21,22 @@
 
 #include "scheduler.h"
 
+static uint64_t getSchedulerTick(std::chrono::system_clock::time_point time)
+{
+	return std::chrono::duration_cast<std::chrono::milliseconds>(time.time_since_epoch()).count();
+}
+
+static std::chrono::system_clock::time_point getSchedulerTime(uint64_t tick)
+{
+	return std::chrono::system_clock::time_point(std::chrono::milliseconds(tick));
+}
+
 Scheduler::Scheduler()
+	: m_rootWheel(), m_wheels()
 {
 	m_lastEventId = 0;
+	m_currentTick = getSchedulerTick(std::chrono::system_clock::now());
+	m_wakeTick = 0;
 	m_threadState = THREAD_STATE_TERMINATED;
 }
 
@@ -35,41 +48,134 @@ void Scheduler::start()
 
 void Scheduler::schedulerThread()
 {
-	std::unique_lock<std::mutex> eventLockUnique(m_eventLock, std::defer_lock);
+	std::vector<SchedulerTask*> expiredTasks;
+	std::unique_lock<std::mutex> eventLockUnique(m_eventLock);
 	while (m_threadState != THREAD_STATE_TERMINATED) {
-		std::cv_status ret = std::cv_status::no_timeout;
+		advance(getSchedulerTick(std::chrono::system_clock::now()), expiredTasks);
+
+		if (!expiredTasks.empty()) {
+			eventLockUnique.unlock();
+			for (SchedulerTask* task : expiredTasks) {
+				task->setDontExpire();
+				g_dispatcher.addTask(task, true);
+			}
+			expiredTasks.clear();
+			eventLockUnique.lock();
+			continue;
+		}
 
-		eventLockUnique.lock();
-		if (m_eventList.empty()) {
+		// sleep until the next occupied slot, addEvent wakes us up earlier if
+		// it inserts an event that is due before that
+		if (m_eventIds.empty()) {
+			m_wakeTick = std::numeric_limits<uint64_t>::max();
 			m_eventSignal.wait(eventLockUnique);
 		} else {
-			ret = m_eventSignal.wait_until(eventLockUnique, m_eventList.top()->getCycle());
+			m_wakeTick = getNextTick();
+			m_eventSignal.wait_until(eventLockUnique, getSchedulerTime(m_wakeTick));
 		}
+		m_wakeTick = 0;
+	}
+}
 
-		// the mutex is locked again now...
-		if (ret == std::cv_status::timeout && m_threadState != THREAD_STATE_TERMINATED) {
-			// ok we had a timeout, so there has to be an event we have to execute...
-			SchedulerTask* task = m_eventList.top();
-			m_eventList.pop();
-
-			// check if the event was stopped
-			auto it = m_eventIds.find(task->getEventId());
-			if (it == m_eventIds.end()) {
-				eventLockUnique.unlock();
-				delete task;
-				continue;
-			}
-			m_eventIds.erase(it);
-			eventLockUnique.unlock();
+void Scheduler::insertTask(SchedulerTask* task)
+{
+	uint64_t expires = std::max<uint64_t>(getSchedulerTick(task->getCycle()), m_currentTick);
+	uint64_t delta = expires - m_currentTick;
 
-			task->setDontExpire();
-			g_dispatcher.addTask(task, true);
-		} else {
-			eventLockUnique.unlock();
+	SchedulerTask** slot;
+	if (delta < SCHEDULER_WHEEL_ROOT_SIZE) {
+		slot = &m_rootWheel[expires & SCHEDULER_WHEEL_ROOT_MASK];
+	} else {
+		const uint64_t maxDelta = (static_cast<uint64_t>(1) << (SCHEDULER_WHEEL_ROOT_BITS + SCHEDULER_WHEEL_LEVELS * SCHEDULER_WHEEL_BITS)) - 1;
+		if (delta > maxDelta) {
+			expires = m_currentTick + maxDelta;
+			delta = maxDelta;
+		}
+
+		uint32_t level = 0;
+		while (delta >> (SCHEDULER_WHEEL_ROOT_BITS + (level + 1) * SCHEDULER_WHEEL_BITS)) {
+			++level;
+		}
+		slot = &m_wheels[level][(expires >> (SCHEDULER_WHEEL_ROOT_BITS + level * SCHEDULER_WHEEL_BITS)) & SCHEDULER_WHEEL_MASK];
+	}
+
+	task->m_next = *slot;
+	if (task->m_next) {
+		task->m_next->m_pprev = &task->m_next;
+	}
+	task->m_pprev = slot;
+	*slot = task;
+}
+
+void Scheduler::unlinkTask(SchedulerTask* task)
+{
+	*task->m_pprev = task->m_next;
+	if (task->m_next) {
+		task->m_next->m_pprev = task->m_pprev;
+	}
+	task->m_next = nullptr;
+	task->m_pprev = nullptr;
+}
+
+uint32_t Scheduler::cascade(uint32_t level)
+{
+	// move every task of the current slot of this level one level inwards
+	uint32_t index = (m_currentTick >> (SCHEDULER_WHEEL_ROOT_BITS + level * SCHEDULER_WHEEL_BITS)) & SCHEDULER_WHEEL_MASK;
+
+	SchedulerTask* task = m_wheels[level][index];
+	m_wheels[level][index] = nullptr;
+	while (task) {
+		SchedulerTask* next = task->m_next;
+		insertTask(task);
+		task = next;
+	}
+	return index;
+}
+
+void Scheduler::advance(uint64_t tick, std::vector<SchedulerTask*>& expiredTasks)
+{
+	if (m_eventIds.empty()) {
+		m_currentTick = std::max<uint64_t>(m_currentTick, tick + 1);
+		return;
+	}
+
+	while (m_currentTick <= tick) {
+		uint32_t index = m_currentTick & SCHEDULER_WHEEL_ROOT_MASK;
+		if (index == 0) {
+			for (uint32_t level = 0; level < SCHEDULER_WHEEL_LEVELS && cascade(level) == 0; ++level);
 		}
+
+		SchedulerTask* task = m_rootWheel[index];
+		m_rootWheel[index] = nullptr;
+		while (task) {
+			SchedulerTask* next = task->m_next;
+			task->m_next = nullptr;
+			task->m_pprev = nullptr;
+			m_eventIds.erase(task->getEventId());
+			expiredTasks.push_back(task);
+			task = next;
+		}
+		++m_currentTick;
 	}
 }
 
+uint64_t Scheduler::getNextTick() const
+{
+	// only the root wheel is scanned, beyond it the next cascade is the
+	// earliest point an outer event can become due
+	if ((m_currentTick & SCHEDULER_WHEEL_ROOT_MASK) == 0) {
+		return m_currentTick;
+	}
+
+	uint64_t endTick = m_currentTick | SCHEDULER_WHEEL_ROOT_MASK;
+	for (uint64_t tick = m_currentTick; tick <= endTick; ++tick) {
+		if (m_rootWheel[tick & SCHEDULER_WHEEL_ROOT_MASK]) {
+			return tick;
+		}
+	}
+	return endTick + 1;
+}
+
 uint32_t Scheduler::addEvent(SchedulerTask* task)
 {
 	bool do_signal = false;
@@ -79,22 +185,28 @@ uint32_t Scheduler::addEvent(SchedulerTask* task)
 		// check if the event has a valid id
 		if (task->getEventId() == 0) {
 			// if not generate one
-			if (++m_lastEventId == 0) {
-				m_lastEventId = 1;
-			}
+			do {
+				if (++m_lastEventId == 0) {
+					m_lastEventId = 1;
+				}
+			} while (m_eventIds.find(m_lastEventId) != m_eventIds.end());
 
 			task->setEventId(m_lastEventId);
 		}
 
+		if (m_eventIds.empty()) {
+			// nothing is stored in the wheel, so it can jump to the current time
+			m_currentTick = getSchedulerTick(std::chrono::system_clock::now());
+		}
+
 		// insert the eventid in the list of active events
-		m_eventIds.insert(task->getEventId());
+		m_eventIds[task->getEventId()] = task;
 
-		// add the event to the queue
-		m_eventList.push(task);
+		// add the event to the wheel
+		insertTask(task);
 
-		// if the list was empty or this event is the top in the list
-		// we have to signal it
-		do_signal = (task == m_eventList.top());
+		// if the scheduler thread sleeps past this event we have to signal it
+		do_signal = getSchedulerTick(task->getCycle()) < m_wakeTick;
 	} else {
 		m_eventLock.unlock();
 		delete task;
@@ -124,7 +236,10 @@ bool Scheduler::stopEvent(uint32_t eventid)
 		return false;
 	}
 
+	SchedulerTask* task = it->second;
 	m_eventIds.erase(it);
+	unlinkTask(task);
+	delete task;
 	return true;
 }
 
@@ -141,12 +256,16 @@ void Scheduler::shutdown()
 	m_threadState = THREAD_STATE_TERMINATED;
 
 	//this list should already be empty
-	while (!m_eventList.empty()) {
-		delete m_eventList.top();
-		m_eventList.pop();
+	for (const auto& it : m_eventIds) {
+		delete it.second;
 	}
-
 	m_eventIds.clear();
+
+	std::fill(std::begin(m_rootWheel), std::end(m_rootWheel), nullptr);
+	for (uint32_t level = 0; level < SCHEDULER_WHEEL_LEVELS; ++level) {
+		std::fill(std::begin(m_wheels[level]), std::end(m_wheels[level]), nullptr);
+	}
+
 	m_eventLock.unlock();
 	m_eventSignal.notify_one();
 }
@@ -21,13 +21,24 @@
 #define FS_SCHEDULER_H_2905B3D5EAB34B4BA8830167262D2DC1
 
 #include "tasks.h"
-#include <unordered_set>
-#include <queue>
+#include <unordered_map>
 
 #include <condition_variable>
 
 #define SCHEDULER_MINTICKS 50
 
+// The scheduler keeps its events in a hierarchical timing wheel with 1 ms
+// ticks. The root wheel covers the next 256 ms, every outer wheel covers 64
+// times the span of the one inside it, so five levels span the full uint32_t
+// delay range.
+#define SCHEDULER_WHEEL_ROOT_BITS 8
+#define SCHEDULER_WHEEL_ROOT_SIZE (1 << SCHEDULER_WHEEL_ROOT_BITS)
+#define SCHEDULER_WHEEL_ROOT_MASK (SCHEDULER_WHEEL_ROOT_SIZE - 1)
+#define SCHEDULER_WHEEL_BITS 6
+#define SCHEDULER_WHEEL_SIZE (1 << SCHEDULER_WHEEL_BITS)
+#define SCHEDULER_WHEEL_MASK (SCHEDULER_WHEEL_SIZE - 1)
+#define SCHEDULER_WHEEL_LEVELS 4
+
 class SchedulerTask : public Task
 {
 	public:
@@ -42,32 +53,31 @@ class SchedulerTask : public Task
 			return m_expiration;
 		}
 
-		bool operator<(const SchedulerTask& other) const {
-			return getCycle() > other.getCycle();
-		}
-
 	protected:
-		SchedulerTask(uint32_t delay, const std::function<void (void)>& f) : Task(delay, f) {
+		SchedulerTask(uint32_t delay, TaskFunction&& f) : Task(delay, std::move(f)) {
 			m_eventid = 0;
+			m_next = nullptr;
+			m_pprev = nullptr;
 		}
 
 		uint32_t m_eventid;
 
-		friend SchedulerTask* createSchedulerTask(uint32_t, const std::function<void (void)>&);
+		// intrusive links of the timing wheel slot this task is stored in
+		SchedulerTask* m_next;
+		SchedulerTask** m_pprev;
+
+		friend class Scheduler;
+		template <typename F>
+		friend SchedulerTask* createSchedulerTask(uint32_t, F&&);
 };
 
-inline SchedulerTask* createSchedulerTask(uint32_t delay, const std::function<void (void)>& f)
-{
-	return new SchedulerTask(std::max<uint32_t>(delay, SCHEDULER_MINTICKS), f);
-}
+static_assert(sizeof(SchedulerTask) <= TASK_ALLOCATOR_BLOCK_SIZE, "SchedulerTask does not fit into a TaskAllocator block");
 
-class lessSchedTask : public std::binary_function<SchedulerTask*&, SchedulerTask*&, bool>
+template <typename F>
+inline SchedulerTask* createSchedulerTask(uint32_t delay, F&& f)
 {
-	public:
-		bool operator()(SchedulerTask*& t1, SchedulerTask*& t2) {
-			return (*t1) < (*t2);
-		}
-};
+	return new SchedulerTask(std::max<uint32_t>(delay, SCHEDULER_MINTICKS), TaskFunction(std::forward<F>(f)));
+}
 
 class Scheduler
 {
@@ -86,13 +96,22 @@ class Scheduler
 	protected:
 		void schedulerThread();
 
+		void insertTask(SchedulerTask* task);
+		static void unlinkTask(SchedulerTask* task);
+		uint32_t cascade(uint32_t level);
+		void advance(uint64_t tick, std::vector<SchedulerTask*>& expiredTasks);
+		uint64_t getNextTick() const;
+
 		std::thread m_thread;
 		std::mutex m_eventLock;
 		std::condition_variable m_eventSignal;
 
 		uint32_t m_lastEventId;
-		std::priority_queue<SchedulerTask*, std::vector<SchedulerTask*>, lessSchedTask > m_eventList;
-		std::unordered_set<uint32_t> m_eventIds;
+		SchedulerTask* m_rootWheel[SCHEDULER_WHEEL_ROOT_SIZE];
+		SchedulerTask* m_wheels[SCHEDULER_WHEEL_LEVELS][SCHEDULER_WHEEL_SIZE];
+		uint64_t m_currentTick;
+		uint64_t m_wakeTick;
+		std::unordered_map<uint32_t, SchedulerTask*> m_eventIds;
 		ThreadState m_threadState;
 };
 
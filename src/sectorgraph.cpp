@@ -0,0 +1,371 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2014  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "otpch.h"
+
+#include "sectorgraph.h"
+#include "map.h"
+
+#include <queue>
+
+void SectorGraph::addTile(const Position& pos)
+{
+	sectors.emplace(getSectorKey(pos), std::vector<uint64_t>());
+}
+
+void SectorGraph::build(const Map& map)
+{
+	dirtySectors.clear();
+	nodes.clear();
+
+	for (auto& it : sectors) {
+		it.second.clear();
+	}
+
+	for (const auto& it : sectors) {
+		buildSector(map, it.first);
+	}
+}
+
+void SectorGraph::invalidate(const Position& pos)
+{
+	dirtySectors.insert(getSectorKey(pos));
+}
+
+void SectorGraph::rebuildDirtySectors(const Map& map)
+{
+	if (dirtySectors.empty()) {
+		return;
+	}
+
+	// the openings on the borders of a sector are nodes of its neighbors too
+	std::unordered_set<uint64_t> rebuild;
+	for (uint64_t sectorKey : dirtySectors) {
+		const Position base = getKeyPosition(sectorKey);
+		rebuild.insert(sectorKey);
+		if (base.x >= SECTOR_SIZE) {
+			rebuild.insert(getKey(base.x - SECTOR_SIZE, base.y, base.z));
+		}
+		if (base.y >= SECTOR_SIZE) {
+			rebuild.insert(getKey(base.x, base.y - SECTOR_SIZE, base.z));
+		}
+		if (base.x + SECTOR_SIZE <= 0xFFFF) {
+			rebuild.insert(getKey(base.x + SECTOR_SIZE, base.y, base.z));
+		}
+		if (base.y + SECTOR_SIZE <= 0xFFFF) {
+			rebuild.insert(getKey(base.x, base.y + SECTOR_SIZE, base.z));
+		}
+	}
+	dirtySectors.clear();
+
+	for (auto it = rebuild.begin(); it != rebuild.end();) {
+		if (sectors.find(*it) == sectors.end()) {
+			it = rebuild.erase(it);
+		} else {
+			removeSector(*it++);
+		}
+	}
+
+	for (uint64_t sectorKey : rebuild) {
+		buildSector(map, sectorKey);
+	}
+}
+
+void SectorGraph::removeSector(uint64_t sectorKey)
+{
+	std::vector<uint64_t>& sectorNodes = sectors[sectorKey];
+	for (uint64_t node : sectorNodes) {
+		nodes.erase(node);
+	}
+	sectorNodes.clear();
+}
+
+void SectorGraph::buildSector(const Map& map, uint64_t sectorKey)
+{
+	const Position base = getKeyPosition(sectorKey);
+
+	SectorTiles walkable;
+	getSectorTiles(map, base, walkable);
+
+	std::vector<uint64_t>& sectorNodes = sectors[sectorKey];
+
+	// north, south, west and east border: the first tile inside the sector,
+	// the step from one border tile to the next and the step outside
+	static const int32_t borders[4][6] = {
+		{0, 0, 1, 0, 0, -1},
+		{0, SECTOR_SIZE - 1, 1, 0, 0, 1},
+		{0, 0, 0, 1, -1, 0},
+		{SECTOR_SIZE - 1, 0, 0, 1, 1, 0}
+	};
+
+	for (const int32_t* border : borders) {
+		const int32_t outsideX = base.x + border[0] + border[4];
+		const int32_t outsideY = base.y + border[1] + border[5];
+		if (outsideX < 0 || outsideY < 0 || outsideX + SECTOR_SIZE > 0xFFFF || outsideY + SECTOR_SIZE > 0xFFFF) {
+			continue;
+		}
+
+		// every run of tiles walkable on both sides is one opening, its node
+		// is the tile in the middle, the neighbor finds the very same runs
+		int32_t runStart = -1;
+		for (int32_t i = 0; i <= SECTOR_SIZE; ++i) {
+			bool open = false;
+			if (i < SECTOR_SIZE) {
+				const int32_t x = border[0] + border[2] * i;
+				const int32_t y = border[1] + border[3] * i;
+				open = walkable[y][x] && isWalkable(map, outsideX + border[2] * i, outsideY + border[3] * i, base.z);
+			}
+
+			if (open) {
+				if (runStart == -1) {
+					runStart = i;
+				}
+				continue;
+			}
+
+			if (runStart == -1) {
+				continue;
+			}
+
+			const int32_t middle = runStart + (i - 1 - runStart) / 2;
+			runStart = -1;
+
+			const uint64_t node = getKey(base.x + border[0] + border[2] * middle, base.y + border[1] + border[3] * middle, base.z);
+			auto it = nodes.find(node);
+			if (it == nodes.end()) {
+				it = nodes.emplace(node, std::vector<Edge>()).first;
+				sectorNodes.push_back(node);
+			}
+
+			Edge edge;
+			edge.node = getKey(outsideX + border[2] * middle, outsideY + border[3] * middle, base.z);
+			edge.cost = MAP_NORMALWALKCOST;
+			it->second.push_back(edge);
+		}
+	}
+
+	SectorCosts costs;
+	for (uint64_t node : sectorNodes) {
+		const Position pos = getKeyPosition(node);
+		getSectorCosts(walkable, pos.x & SECTOR_MASK, pos.y & SECTOR_MASK, costs);
+
+		std::vector<Edge>& edges = nodes[node];
+		for (uint64_t other : sectorNodes) {
+			if (other == node) {
+				continue;
+			}
+
+			const Position otherPos = getKeyPosition(other);
+			const int32_t cost = costs[otherPos.y & SECTOR_MASK][otherPos.x & SECTOR_MASK];
+			if (cost != std::numeric_limits<int32_t>::max()) {
+				Edge edge;
+				edge.node = other;
+				edge.cost = cost;
+				edges.push_back(edge);
+			}
+		}
+	}
+}
+
+bool SectorGraph::getPath(const Map& map, const Position& fromPos, const Position& toPos, std::vector<Position>& waypoints)
+{
+	rebuildDirtySectors(map);
+
+	if (fromPos.z != toPos.z) {
+		return false;
+	}
+
+	const uint64_t fromSector = getSectorKey(fromPos);
+	const uint64_t toSector = getSectorKey(toPos);
+	if (fromSector == toSector) {
+		return false;
+	}
+
+	auto fromIt = sectors.find(fromSector);
+	auto toIt = sectors.find(toSector);
+	if (fromIt == sectors.end() || toIt == sectors.end()) {
+		return false;
+	}
+
+	SectorTiles walkable;
+	SectorCosts costs;
+
+	// costs are the same both ways, so the ones from the target position
+	// are what it takes to get there from each node of its sector
+	getSectorTiles(map, getKeyPosition(toSector), walkable);
+	getSectorCosts(walkable, toPos.x & SECTOR_MASK, toPos.y & SECTOR_MASK, costs);
+
+	std::unordered_map<uint64_t, int32_t> goalCosts;
+	for (uint64_t node : toIt->second) {
+		const Position pos = getKeyPosition(node);
+		const int32_t cost = costs[pos.y & SECTOR_MASK][pos.x & SECTOR_MASK];
+		if (cost != std::numeric_limits<int32_t>::max()) {
+			goalCosts[node] = cost;
+		}
+	}
+
+	if (goalCosts.empty()) {
+		return false;
+	}
+
+	getSectorTiles(map, getKeyPosition(fromSector), walkable);
+	getSectorCosts(walkable, fromPos.x & SECTOR_MASK, fromPos.y & SECTOR_MASK, costs);
+
+	// the goal is not a node of its own, it gets a key no position maps to,
+	// which also marks the nodes reached straight from the start
+	const uint64_t goal = std::numeric_limits<uint64_t>::max();
+
+	auto heuristic = [&toPos](uint64_t node) {
+		if (node == goal) {
+			return 0;
+		}
+
+		const Position pos = getKeyPosition(node);
+		return std::max<int32_t>(Position::getDistanceX(pos, toPos), Position::getDistanceY(pos, toPos)) * MAP_NORMALWALKCOST;
+	};
+
+	// node -> cheapest cost found so far and the node it was reached from
+	std::unordered_map<uint64_t, std::pair<int32_t, uint64_t>> visited;
+
+	typedef std::pair<int32_t, uint64_t> QueueEntry;
+	std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> queue;
+
+	for (uint64_t node : fromIt->second) {
+		const Position pos = getKeyPosition(node);
+		const int32_t cost = costs[pos.y & SECTOR_MASK][pos.x & SECTOR_MASK];
+		if (cost != std::numeric_limits<int32_t>::max()) {
+			visited[node] = std::make_pair(cost, goal);
+			queue.emplace(cost + heuristic(node), node);
+		}
+	}
+
+	uint32_t expanded = 0;
+	while (!queue.empty()) {
+		const int32_t f = queue.top().first;
+		const uint64_t node = queue.top().second;
+		queue.pop();
+
+		const int32_t g = visited[node].first;
+		if (f > g + heuristic(node)) {
+			// reached again more cheaply after this entry was queued
+			continue;
+		}
+
+		if (node == goal) {
+			for (uint64_t step = visited[goal].second; step != goal; step = visited[step].second) {
+				waypoints.push_back(getKeyPosition(step));
+			}
+			std::reverse(waypoints.begin(), waypoints.end());
+			return true;
+		}
+
+		if (++expanded > SECTOR_GRAPH_MAX_NODES) {
+			return false;
+		}
+
+		auto goalIt = goalCosts.find(node);
+		if (goalIt != goalCosts.end()) {
+			const int32_t cost = g + goalIt->second;
+			auto it = visited.find(goal);
+			if (it == visited.end() || cost < it->second.first) {
+				visited[goal] = std::make_pair(cost, node);
+				queue.emplace(cost, goal);
+			}
+		}
+
+		auto nodeIt = nodes.find(node);
+		if (nodeIt == nodes.end()) {
+			continue;
+		}
+
+		for (const Edge& edge : nodeIt->second) {
+			const int32_t cost = g + edge.cost;
+			auto it = visited.find(edge.node);
+			if (it == visited.end() || cost < it->second.first) {
+				visited[edge.node] = std::make_pair(cost, node);
+				queue.emplace(cost + heuristic(edge.node), edge.node);
+			}
+		}
+	}
+	return false;
+}
+
+bool SectorGraph::isWalkable(const Map& map, int32_t x, int32_t y, int32_t z)
+{
+	// asks for the flags only, building the graph must not unshare every tile
+	uint32_t flags;
+	if (!map.getGroundTileFlags(x, y, z, flags)) {
+		return false;
+	}
+
+	// house doors and tiles depend on who walks there, they are left out
+	return (flags & (TILESTATE_FLOORCHANGE | TILESTATE_TELEPORT | TILESTATE_BLOCKSOLID | TILESTATE_HOUSE)) == 0;
+}
+
+void SectorGraph::getSectorTiles(const Map& map, const Position& base, SectorTiles& walkable)
+{
+	for (int32_t y = 0; y < SECTOR_SIZE; ++y) {
+		for (int32_t x = 0; x < SECTOR_SIZE; ++x) {
+			walkable[y][x] = isWalkable(map, base.x + x, base.y + y, base.z);
+		}
+	}
+}
+
+void SectorGraph::getSectorCosts(const SectorTiles& walkable, int32_t startX, int32_t startY, SectorCosts& costs)
+{
+	for (int32_t y = 0; y < SECTOR_SIZE; ++y) {
+		for (int32_t x = 0; x < SECTOR_SIZE; ++x) {
+			costs[y][x] = std::numeric_limits<int32_t>::max();
+		}
+	}
+
+	typedef std::pair<int32_t, uint16_t> QueueEntry;
+	std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> queue;
+
+	// the start may be a blocking tile (e.g. a depot the path leads to)
+	costs[startY][startX] = 0;
+	queue.emplace(0, startY * SECTOR_SIZE + startX);
+
+	while (!queue.empty()) {
+		const int32_t cost = queue.top().first;
+		const int32_t x = queue.top().second % SECTOR_SIZE;
+		const int32_t y = queue.top().second / SECTOR_SIZE;
+		queue.pop();
+
+		if (cost != costs[y][x]) {
+			continue;
+		}
+
+		for (int32_t dy = -1; dy <= 1; ++dy) {
+			for (int32_t dx = -1; dx <= 1; ++dx) {
+				const int32_t nx = x + dx;
+				const int32_t ny = y + dy;
+				if ((dx == 0 && dy == 0) || nx < 0 || ny < 0 || nx >= SECTOR_SIZE || ny >= SECTOR_SIZE || !walkable[ny][nx]) {
+					continue;
+				}
+
+				const int32_t newCost = cost + (dx != 0 && dy != 0 ? MAP_DIAGONALWALKCOST : MAP_NORMALWALKCOST);
+				if (newCost < costs[ny][nx]) {
+					costs[ny][nx] = newCost;
+					queue.emplace(newCost, ny * SECTOR_SIZE + nx);
+				}
+			}
+		}
+	}
+}
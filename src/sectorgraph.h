@@ -0,0 +1,103 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2014  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef FS_SECTORGRAPH_H_8C1F3A0E5B7D4E2C9A6F1D3B5E7C9A2F
+#define FS_SECTORGRAPH_H_8C1F3A0E5B7D4E2C9A6F1D3B5E7C9A2F
+
+#include <unordered_set>
+
+#include "position.h"
+
+class Map;
+
+#define SECTOR_SIZE 16
+#define SECTOR_MASK (SECTOR_SIZE - 1)
+#define SECTOR_GRAPH_MAX_NODES 65536
+
+/**
+  * Abstract graph over the SECTOR_SIZE x SECTOR_SIZE sectors of each floor,
+  * used for paths too long for a plain A* search. Its nodes are the tiles in
+  * the middle of each opening between two neighboring sectors, the edges
+  * hold the walking cost between the nodes of one sector and across each
+  * opening. Only what blocks every player is taken into account, the final
+  * path is still walked out with the creature's own A* search.
+  */
+class SectorGraph
+{
+	public:
+		/**
+		  * Registers the sector of a tile, called while the map is loaded.
+		  */
+		void addTile(const Position& pos);
+
+		/**
+		  * Builds the graph for every registered sector.
+		  */
+		void build(const Map& map);
+
+		/**
+		  * Marks the sector of a tile whose walkability changed, it is
+		  * rebuilt along with its neighbors on the next query.
+		  */
+		void invalidate(const Position& pos);
+
+		/**
+		  * Finds the nodes to walk through from one position to another on the
+		  * same floor, in order and without the positions themselves.
+		  * \returns false if there is no route over the graph
+		  */
+		bool getPath(const Map& map, const Position& fromPos, const Position& toPos, std::vector<Position>& waypoints);
+
+		static bool isWalkable(const Map& map, int32_t x, int32_t y, int32_t z);
+
+	private:
+		struct Edge {
+			uint64_t node;
+			int32_t cost;
+		};
+
+		typedef bool SectorTiles[SECTOR_SIZE][SECTOR_SIZE];
+		typedef int32_t SectorCosts[SECTOR_SIZE][SECTOR_SIZE];
+
+		static uint64_t getKey(uint32_t x, uint32_t y, uint32_t z) {
+			return (static_cast<uint64_t>(z) << 32) | (y << 16) | x;
+		}
+		static uint64_t getSectorKey(const Position& pos) {
+			return getKey(pos.x & ~SECTOR_MASK, pos.y & ~SECTOR_MASK, pos.z);
+		}
+		static Position getKeyPosition(uint64_t key) {
+			return Position(key & 0xFFFF, (key >> 16) & 0xFFFF, key >> 32);
+		}
+
+		void buildSector(const Map& map, uint64_t sectorKey);
+		void removeSector(uint64_t sectorKey);
+		void rebuildDirtySectors(const Map& map);
+
+		static void getSectorTiles(const Map& map, const Position& base, SectorTiles& walkable);
+		// walking cost from a tile of the sector to every other one of it
+		static void getSectorCosts(const SectorTiles& walkable, int32_t startX, int32_t startY, SectorCosts& costs);
+
+		// sector key -> its nodes
+		std::unordered_map<uint64_t, std::vector<uint64_t>> sectors;
+		// node key -> its edges
+		std::unordered_map<uint64_t, std::vector<Edge>> nodes;
+		std::unordered_set<uint64_t> dirtySectors;
+};
+
+#endif
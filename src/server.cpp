@@ -29,8 +29,12 @@
 extern ConfigManager g_config;
 Ban g_bans;
 
+#ifdef SO_REUSEPORT
+typedef boost::asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT> reuse_port;
+#endif
+
 ServiceManager::ServiceManager()
-	: m_io_service(), death_timer(m_io_service), running(false)
+	: m_io_service(), death_timer(m_io_service), m_connectionServicesCreated(false), running(false)
 {
 	//
 }
@@ -38,10 +42,19 @@ ServiceManager::ServiceManager()
 ServiceManager::~ServiceManager()
 {
 	stop();
+
+	for (boost::asio::io_service* io_service : m_connectionServices) {
+		delete io_service;
+	}
 }
 
 void ServiceManager::die()
 {
+	m_connectionWork.clear();
+	for (boost::asio::io_service* io_service : m_connectionServices) {
+		io_service->stop();
+	}
+
 	m_io_service.stop();
 }
 
@@ -49,7 +62,20 @@ void ServiceManager::run()
 {
 	assert(!running);
 	running = true;
+
+	for (boost::asio::io_service* io_service : m_connectionServices) {
+		m_connectionWork.emplace_back(*io_service);
+		m_connectionThreads.emplace_back([io_service]() {
+			io_service->run();
+		});
+	}
+
 	m_io_service.run();
+
+	for (std::thread& thread : m_connectionThreads) {
+		thread.join();
+	}
+	m_connectionThreads.clear();
 }
 
 void ServiceManager::stop()
@@ -77,11 +103,29 @@ void ServiceManager::stop()
 	death_timer.async_wait(std::bind(&ServiceManager::die, this));
 }
 
-ServicePort::ServicePort(boost::asio::io_service& io_service) :
+const std::vector<boost::asio::io_service*>& ServiceManager::getConnectionServices()
+{
+	// created with the first service, the config is not loaded before that
+	if (!m_connectionServicesCreated) {
+		m_connectionServicesCreated = true;
+
+		int32_t threads = g_config.getNumber(ConfigManager::NETWORK_THREADS);
+		if (threads > 1) {
+			for (int32_t i = 0; i < threads; ++i) {
+				m_connectionServices.push_back(new boost::asio::io_service());
+			}
+		}
+	}
+	return m_connectionServices;
+}
+
+ServicePort::ServicePort(boost::asio::io_service& io_service, const std::vector<boost::asio::io_service*>& connectionServices) :
 	m_io_service(io_service),
-	m_acceptor(nullptr),
+	m_connectionServices(connectionServices),
+	m_nextService(0),
 	m_serverPort(0),
-	m_pendingStart(false)
+	m_pendingStart(false),
+	m_reusePort(false)
 {
 	//
 }
@@ -111,17 +155,28 @@ std::string ServicePort::get_protocol_names() const
 	return str;
 }
 
-void ServicePort::accept()
+void ServicePort::accept(size_t index)
 {
-	if (!m_acceptor) {
+	std::lock_guard<std::recursive_mutex> lockClass(m_acceptorLock);
+
+	if (index >= m_acceptors.size()) {
 		return;
 	}
 
-	boost::asio::ip::tcp::socket* socket = new boost::asio::ip::tcp::socket(m_io_service);
-	m_acceptor->async_accept(*socket, std::bind(&ServicePort::onAccept, this, socket, std::placeholders::_1));
+	boost::asio::io_service* io_service;
+	if (m_connectionServices.empty()) {
+		io_service = &m_io_service;
+	} else if (m_reusePort) {
+		io_service = m_connectionServices[index];
+	} else {
+		io_service = m_connectionServices[m_nextService++ % m_connectionServices.size()];
+	}
+
+	boost::asio::ip::tcp::socket* socket = new boost::asio::ip::tcp::socket(*io_service);
+	m_acceptors[index]->async_accept(*socket, std::bind(&ServicePort::onAccept, this, index, io_service, socket, std::placeholders::_1));
 }
 
-void ServicePort::onAccept(boost::asio::ip::tcp::socket* socket, const boost::system::error_code& error)
+void ServicePort::onAccept(size_t index, boost::asio::io_service* io_service, boost::asio::ip::tcp::socket* socket, const boost::system::error_code& error)
 {
 	if (!error) {
 		if (m_services.empty()) {
@@ -137,7 +192,7 @@ void ServicePort::onAccept(boost::asio::ip::tcp::socket* socket, const boost::sy
 		}
 
 		if (remote_ip != 0 && g_bans.acceptConnection(remote_ip)) {
-			Connection_ptr connection = ConnectionManager::getInstance()->createConnection(socket, m_io_service, shared_from_this());
+			Connection_ptr connection = ConnectionManager::getInstance()->createConnection(socket, *io_service, shared_from_this());
 			Service_ptr service = m_services.front();
 			if (service->is_single_socket()) {
 				connection->acceptConnection(service->make_protocol(connection));
@@ -150,8 +205,10 @@ void ServicePort::onAccept(boost::asio::ip::tcp::socket* socket, const boost::sy
 			delete socket;
 		}
 
-		accept();
+		accept(index);
 	} else if (error != boost::asio::error::operation_aborted) {
+		std::lock_guard<std::recursive_mutex> lockClass(m_acceptorLock);
+
 		if (!m_pendingStart) {
 			close();
 			m_pendingStart = true;
@@ -194,23 +251,51 @@ void ServicePort::openAcceptor(std::weak_ptr<ServicePort> weak_service, uint16_t
 
 void ServicePort::open(uint16_t port)
 {
+	std::lock_guard<std::recursive_mutex> lockClass(m_acceptorLock);
+
 	close();
 
 	m_serverPort = port;
 	m_pendingStart = false;
 
+#ifdef SO_REUSEPORT
+	m_reusePort = m_connectionServices.size() > 1 && g_config.getBoolean(ConfigManager::NETWORK_REUSE_PORT);
+#endif
+
 	try {
+		boost::asio::ip::tcp::endpoint endpoint;
 		if (g_config.getBoolean(ConfigManager::BIND_ONLY_GLOBAL_ADDRESS)) {
-			m_acceptor = new boost::asio::ip::tcp::acceptor(m_io_service, boost::asio::ip::tcp::endpoint(
-			            boost::asio::ip::address(boost::asio::ip::address_v4::from_string(g_config.getString(ConfigManager::IP))), m_serverPort));
+			endpoint = boost::asio::ip::tcp::endpoint(
+			            boost::asio::ip::address(boost::asio::ip::address_v4::from_string(g_config.getString(ConfigManager::IP))), m_serverPort);
 		} else {
-			m_acceptor = new boost::asio::ip::tcp::acceptor(m_io_service, boost::asio::ip::tcp::endpoint(
-			            boost::asio::ip::address(boost::asio::ip::address_v4(INADDR_ANY)), m_serverPort));
+			endpoint = boost::asio::ip::tcp::endpoint(
+			            boost::asio::ip::address(boost::asio::ip::address_v4(INADDR_ANY)), m_serverPort);
 		}
 
-		m_acceptor->set_option(boost::asio::ip::tcp::no_delay(true));
+#ifdef SO_REUSEPORT
+		if (m_reusePort) {
+			// one listening socket per network thread, the kernel hands
+			// each new connection to one of them
+			for (boost::asio::io_service* io_service : m_connectionServices) {
+				boost::asio::ip::tcp::acceptor* acceptor = new boost::asio::ip::tcp::acceptor(*io_service);
+				m_acceptors.push_back(acceptor);
+
+				acceptor->open(endpoint.protocol());
+				acceptor->set_option(boost::asio::ip::tcp::acceptor::reuse_address(true));
+				acceptor->set_option(reuse_port(true));
+				acceptor->bind(endpoint);
+				acceptor->listen();
+			}
+		} else
+#endif
+		{
+			m_acceptors.push_back(new boost::asio::ip::tcp::acceptor(m_io_service, endpoint));
+		}
 
-		accept();
+		for (size_t i = 0; i < m_acceptors.size(); ++i) {
+			m_acceptors[i]->set_option(boost::asio::ip::tcp::no_delay(true));
+			accept(i);
+		}
 	} catch (boost::system::system_error& e) {
 		std::cout << "[ServicePort::open] Error: " << e.what() << std::endl;
 
@@ -222,15 +307,17 @@ void ServicePort::open(uint16_t port)
 
 void ServicePort::close()
 {
-	if (m_acceptor) {
-		if (m_acceptor->is_open()) {
+	std::lock_guard<std::recursive_mutex> lockClass(m_acceptorLock);
+
+	for (boost::asio::ip::tcp::acceptor* acceptor : m_acceptors) {
+		if (acceptor->is_open()) {
 			boost::system::error_code error;
-			m_acceptor->close(error);
+			acceptor->close(error);
 		}
 
-		delete m_acceptor;
-		m_acceptor = nullptr;
+		delete acceptor;
 	}
+	m_acceptors.clear();
 }
 
 bool ServicePort::add_service(Service_ptr new_svc)
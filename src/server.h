@@ -67,7 +67,7 @@ class Service : public ServiceBase
 class ServicePort : public std::enable_shared_from_this<ServicePort>
 {
 	public:
-		ServicePort(boost::asio::io_service& io_service);
+		ServicePort(boost::asio::io_service& io_service, const std::vector<boost::asio::io_service*>& connectionServices);
 		~ServicePort();
 
 		// non-copyable
@@ -84,17 +84,25 @@ class ServicePort : public std::enable_shared_from_this<ServicePort>
 		Protocol* make_protocol(bool checksummed, NetworkMessage& msg) const;
 
 		void onStopServer();
-		void onAccept(boost::asio::ip::tcp::socket* socket, const boost::system::error_code& error);
+		void onAccept(size_t index, boost::asio::io_service* io_service, boost::asio::ip::tcp::socket* socket, const boost::system::error_code& error);
 
 	protected:
-		void accept();
+		void accept(size_t index);
 
 		boost::asio::io_service& m_io_service;
-		boost::asio::ip::tcp::acceptor* m_acceptor;
+
+		// connections are spread over these, with SO_REUSEPORT each of them
+		// also gets an acceptor of its own (m_acceptors[i] runs on service i)
+		std::vector<boost::asio::io_service*> m_connectionServices;
+		std::vector<boost::asio::ip::tcp::acceptor*> m_acceptors;
 		std::vector<Service_ptr> m_services;
 
+		std::recursive_mutex m_acceptorLock;
+
+		size_t m_nextService;
 		uint16_t m_serverPort;
 		bool m_pendingStart;
+		bool m_reusePort;
 };
 
 typedef std::shared_ptr<ServicePort> ServicePort_ptr;
@@ -124,10 +132,20 @@ class ServiceManager
 	protected:
 		void die();
 
+		const std::vector<boost::asio::io_service*>& getConnectionServices();
+
 		std::map<uint16_t, ServicePort_ptr> m_acceptors;
 
 		boost::asio::io_service m_io_service;
 		boost::asio::deadline_timer death_timer;
+
+		// with networkThreads > 1 the connections run on these, one thread
+		// each, while m_io_service only does the accepting
+		std::vector<boost::asio::io_service*> m_connectionServices;
+		std::vector<boost::asio::io_service::work> m_connectionWork;
+		std::vector<std::thread> m_connectionThreads;
+		bool m_connectionServicesCreated;
+
 		bool running;
 };
 
@@ -145,7 +163,7 @@ bool ServiceManager::add(uint16_t port)
 	    m_acceptors.find(port);
 
 	if (finder == m_acceptors.end()) {
-		service_port.reset(new ServicePort(m_io_service));
+		service_port.reset(new ServicePort(m_io_service, getConnectionServices()));
 		service_port->open(port);
 		m_acceptors[port] = service_port;
 	} else {
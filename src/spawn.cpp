@@ -37,6 +37,8 @@ extern Game g_game;
 
 Spawns::Spawns()
 {
+	checkEventTime = 0;
+	checkEvent = 0;
 	loaded = false;
 	started = false;
 }
@@ -157,8 +159,15 @@ void Spawns::startup()
 
 void Spawns::clear()
 {
+	if (checkEvent != 0) {
+		g_scheduler.stopEvent(checkEvent);
+		checkEvent = 0;
+	}
+
+	spawnChecks = std::priority_queue<SpawnCheck>();
+	blockedSpawns.clear();
+
 	for (Spawn* spawn : spawnList) {
-		spawn->stopEvent();
 		delete spawn;
 	}
 
@@ -179,11 +188,142 @@ bool Spawns::isInZone(const Position& centerPos, int32_t radius, const Position&
 	        (pos.getY() >= centerPos.getY() - radius) && (pos.getY() <= centerPos.getY() + radius));
 }
 
+void Spawns::scheduleCheck(Spawn* spawn, int64_t time)
+{
+	if (spawn->nextCheck != 0 && spawn->nextCheck <= time) {
+		return;
+	}
+
+	spawn->nextCheck = time;
+	spawnChecks.push(SpawnCheck{time, spawn});
+	updateCheckEvent();
+}
+
+void Spawns::updateCheckEvent()
+{
+	if (spawnChecks.empty()) {
+		return;
+	}
+
+	int64_t time = spawnChecks.top().time;
+	if (checkEvent != 0) {
+		if (checkEventTime <= time) {
+			return;
+		}
+		g_scheduler.stopEvent(checkEvent);
+	}
+
+	checkEventTime = time;
+	checkEvent = g_scheduler.addEvent(createSchedulerTask(std::max<int64_t>(time - OTSYS_TIME(), 0), std::bind(&Spawns::checkSpawns, this)));
+}
+
+void Spawns::checkSpawns()
+{
+	checkEvent = 0;
+
+	int64_t now = OTSYS_TIME();
+	while (!spawnChecks.empty()) {
+		SpawnCheck check = spawnChecks.top();
+		if (check.time > now) {
+			break;
+		}
+
+		spawnChecks.pop();
+		if (check.spawn->nextCheck != check.time) {
+			continue;
+		}
+
+		check.spawn->nextCheck = 0;
+		check.spawn->checkSpawn();
+	}
+
+	updateCheckEvent();
+}
+
+void Spawns::blockSpawn(Spawn* spawn, uint32_t spawnId, const Position& pos)
+{
+	blockedSpawns[getSectorKey(pos.x, pos.y, pos.z)].push_back(BlockedSpawn{spawn, spawnId, pos});
+}
+
+void Spawns::onPlayerMove(const Position& oldPos, const Position& newPos)
+{
+	unblockSpawns(oldPos, &newPos);
+}
+
+void Spawns::onPlayerLeave(const Position& pos)
+{
+	unblockSpawns(pos, nullptr);
+}
+
+static bool isInSpawnView(const Position& playerPos, const Position& pos)
+{
+	// the range Spawn::findPlayer looks for players in
+	return playerPos.z == pos.z && Position::getDistanceX(playerPos, pos) <= Map::maxViewportX &&
+	       Position::getDistanceY(playerPos, pos) <= Map::maxViewportY;
+}
+
+void Spawns::unblockSpawns(const Position& oldPos, const Position* newPos)
+{
+	if (blockedSpawns.empty()) {
+		return;
+	}
+
+	// release the blocks the player could see from oldPos but no longer sees
+	// from newPos, if another player still sees one it is parked again when due
+	std::vector<BlockedSpawn> unblocked;
+
+	const int32_t startX = std::max<int32_t>(oldPos.x - Map::maxViewportX, 0) >> SPAWN_SECTOR_BITS;
+	const int32_t endX = (oldPos.x + Map::maxViewportX) >> SPAWN_SECTOR_BITS;
+	const int32_t startY = std::max<int32_t>(oldPos.y - Map::maxViewportY, 0) >> SPAWN_SECTOR_BITS;
+	const int32_t endY = (oldPos.y + Map::maxViewportY) >> SPAWN_SECTOR_BITS;
+	for (int32_t y = startY; y <= endY; ++y) {
+		for (int32_t x = startX; x <= endX; ++x) {
+			auto it = blockedSpawns.find(getSectorKey(x << SPAWN_SECTOR_BITS, y << SPAWN_SECTOR_BITS, oldPos.z));
+			if (it == blockedSpawns.end()) {
+				continue;
+			}
+
+			std::vector<BlockedSpawn>& blocks = it->second;
+			size_t keep = 0;
+			for (size_t i = 0, size = blocks.size(); i < size; ++i) {
+				const BlockedSpawn& block = blocks[i];
+				if (isInSpawnView(oldPos, block.pos) && (!newPos || !isInSpawnView(*newPos, block.pos))) {
+					unblocked.push_back(block);
+				} else {
+					blocks[keep++] = block;
+				}
+			}
+
+			if (keep == 0) {
+				blockedSpawns.erase(it);
+			} else {
+				blocks.resize(keep);
+			}
+		}
+	}
+
+	for (const BlockedSpawn& block : unblocked) {
+		block.spawn->unblockSpawn(block.spawnId);
+	}
+}
+
 void Spawn::startSpawnCheck()
 {
-	if (checkSpawnEvent == 0) {
-		checkSpawnEvent = g_scheduler.addEvent(createSchedulerTask(getInterval(), std::bind(&Spawn::checkSpawn, this)));
+	Spawns::getInstance()->scheduleCheck(this, OTSYS_TIME() + getInterval());
+}
+
+void Spawn::unblockSpawn(uint32_t spawnId)
+{
+	auto it = spawnMap.find(spawnId);
+	if (it == spawnMap.end()) {
+		return;
 	}
+
+	// like before, a block only spawns after a full interval without players around
+	spawnBlock_t& sb = it->second;
+	sb.blocked = false;
+	sb.lastSpawn = OTSYS_TIME();
+	Spawns::getInstance()->scheduleCheck(this, sb.lastSpawn + sb.interval);
 }
 
 Spawn::~Spawn()
@@ -253,11 +393,13 @@ void Spawn::startup()
 
 void Spawn::checkSpawn()
 {
-	checkSpawnEvent = 0;
-
 	cleanup();
 
+	const int64_t now = OTSYS_TIME();
+	const uint32_t maxSpawnCount = g_config.getNumber(ConfigManager::RATE_SPAWN);
+
 	uint32_t spawnCount = 0;
+	int64_t next = 0;
 
 	for (auto& it : spawnMap) {
 		uint32_t spawnId = it.first;
@@ -266,21 +408,34 @@ void Spawn::checkSpawn()
 		}
 
 		spawnBlock_t& sb = it.second;
-		if (OTSYS_TIME() >= sb.lastSpawn + sb.interval) {
+		if (sb.blocked) {
+			continue;
+		}
+
+		int64_t time = sb.lastSpawn + sb.interval;
+		if (now >= time) {
 			if (findPlayer(sb.pos)) {
-				sb.lastSpawn = OTSYS_TIME();
+				sb.blocked = true;
+				Spawns::getInstance()->blockSpawn(this, spawnId, sb.pos);
 				continue;
 			}
 
-			spawnMonster(spawnId, sb.mType, sb.pos, sb.direction);
-			if (++spawnCount >= static_cast<uint32_t>(g_config.getNumber(ConfigManager::RATE_SPAWN))) {
-				break;
+			// over the spawn rate or the tile is taken, try again later
+			if (spawnCount >= maxSpawnCount || !spawnMonster(spawnId, sb.mType, sb.pos, sb.direction)) {
+				time = now + getInterval();
+			} else {
+				++spawnCount;
+				continue;
 			}
 		}
+
+		if (next == 0 || time < next) {
+			next = time;
+		}
 	}
 
-	if (spawnedMap.size() < spawnMap.size()) {
-		checkSpawnEvent = g_scheduler.addEvent(createSchedulerTask(getInterval(), std::bind(&Spawn::checkSpawn, this)));
+	if (next != 0) {
+		Spawns::getInstance()->scheduleCheck(this, next);
 	}
 }
 
@@ -324,6 +479,7 @@ bool Spawn::addMonster(const std::string& _name, const Position& _pos, Direction
 	sb.direction = _dir;
 	sb.interval = _interval;
 	sb.lastSpawn = 0;
+	sb.blocked = false;
 
 	uint32_t spawnId = spawnMap.size() + 1;
 	spawnMap[spawnId] = sb;
@@ -340,11 +496,3 @@ void Spawn::removeMonster(Monster* monster)
 		}
 	}
 }
-
-void Spawn::stopEvent()
-{
-	if (checkSpawnEvent != 0) {
-		g_scheduler.stopEvent(checkSpawnEvent);
-		checkSpawnEvent = 0;
-	}
-}
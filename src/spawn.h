@@ -20,12 +20,18 @@
 #ifndef FS_SPAWN_H_1A86089E080846A9AE53ED12E7AE863B
 #define FS_SPAWN_H_1A86089E080846A9AE53ED12E7AE863B
 
+#include <queue>
+
 #include "tile.h"
 #include "position.h"
 #include "monster.h"
 
 class Spawn;
 
+// parked spawn blocks are bucketed by 8x8 sectors of each floor, a player
+// moving only looks at the sectors its old position could see
+#define SPAWN_SECTOR_BITS 3
+
 class Spawns
 {
 	private:
@@ -49,10 +55,57 @@ class Spawns
 			return started;
 		}
 
+		/**
+		  * Schedules Spawn::checkSpawn on the shared spawn timer, an earlier
+		  * check replaces a later one already scheduled for the same spawn.
+		  */
+		void scheduleCheck(Spawn* spawn, int64_t time);
+
+		/**
+		  * Parks a spawn block that could not spawn because a player was in
+		  * view, it is not looked at again until a player that could see it
+		  * moves out of view or logs out.
+		  */
+		void blockSpawn(Spawn* spawn, uint32_t spawnId, const Position& pos);
+
+		void onPlayerMove(const Position& oldPos, const Position& newPos);
+		void onPlayerLeave(const Position& pos);
+
 	private:
+		struct SpawnCheck {
+			int64_t time;
+			Spawn* spawn;
+
+			bool operator<(const SpawnCheck& other) const {
+				return time > other.time;
+			}
+		};
+
+		struct BlockedSpawn {
+			Spawn* spawn;
+			uint32_t spawnId;
+			Position pos;
+		};
+
+		static uint64_t getSectorKey(uint32_t x, uint32_t y, uint32_t z) {
+			return (static_cast<uint64_t>(z) << 32) | ((y >> SPAWN_SECTOR_BITS) << 16) | (x >> SPAWN_SECTOR_BITS);
+		}
+
+		void checkSpawns();
+		void updateCheckEvent();
+		void unblockSpawns(const Position& oldPos, const Position* newPos);
+
 		std::list<Npc*> npcList;
 		std::list<Spawn*> spawnList;
+
+		// min-heap on time, entries of a spawn whose nextCheck moved are stale
+		std::priority_queue<SpawnCheck> spawnChecks;
+		// sector key -> blocks waiting for the players around to leave
+		std::unordered_map<uint64_t, std::vector<BlockedSpawn>> blockedSpawns;
+
 		std::string filename;
+		int64_t checkEventTime;
+		uint32_t checkEvent;
 		bool loaded, started;
 };
 
@@ -62,12 +115,13 @@ struct spawnBlock_t {
 	int64_t lastSpawn;
 	uint32_t interval;
 	Direction direction;
+	bool blocked;
 };
 
 class Spawn
 {
 	public:
-		Spawn(const Position& pos, int32_t radius) : centerPos(pos), radius(radius), interval(60000), checkSpawnEvent() {}
+		Spawn(const Position& pos, int32_t radius) : centerPos(pos), radius(radius), interval(60000), nextCheck(0) {}
 		~Spawn();
 
 		bool addMonster(const std::string& _name, const Position& _pos, Direction _dir, uint32_t _interval);
@@ -79,7 +133,7 @@ class Spawn
 		void startup();
 
 		void startSpawnCheck();
-		void stopEvent();
+		void unblockSpawn(uint32_t spawnId);
 
 		bool isInSpawnZone(const Position& pos);
 		void cleanup();
@@ -97,11 +151,13 @@ class Spawn
 		int32_t radius;
 
 		uint32_t interval;
-		uint32_t checkSpawnEvent;
+		int64_t nextCheck;
 
 		static bool findPlayer(const Position& pos);
 		bool spawnMonster(uint32_t spawnId, MonsterType* mType, const Position& pos, Direction dir, bool startup = false);
 		void checkSpawn();
+
+		friend class Spawns;
 };
 
 #endif
@@ -0,0 +1,53 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2014  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "otpch.h"
+
+#include "spectators.h"
+
+// never freed: the map keeps spectator lists around until it is destroyed
+// itself, which may be after this translation unit's statics are gone
+std::vector<std::vector<Creature*>>* SpectatorVec::pool = nullptr;
+
+void SpectatorVec::acquire()
+{
+	if (pool && !pool->empty()) {
+		vec.swap(pool->back());
+		pool->pop_back();
+	} else {
+		vec.reserve(32);
+	}
+}
+
+void SpectatorVec::release()
+{
+	if (!pool) {
+		pool = new std::vector<std::vector<Creature*>>();
+		pool->reserve(SPECTATOR_POOL_SIZE);
+	}
+
+	// lists that grew very large are not kept around
+	if (pool->size() >= SPECTATOR_POOL_SIZE || vec.capacity() > SPECTATOR_POOL_MAX_CAPACITY) {
+		return;
+	}
+
+	vec.clear();
+	pool->emplace_back();
+	pool->back().swap(vec);
+}
@@ -0,0 +1,135 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2014  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef FS_SPECTATORS_H_D78A7CCB7080406E8CAA6B1D31D3DA71
+#define FS_SPECTATORS_H_D78A7CCB7080406E8CAA6B1D31D3DA71
+
+class Creature;
+
+#define SPECTATOR_POOL_SIZE 64
+#define SPECTATOR_POOL_MAX_CAPACITY 1024
+// merges needing more compares than this sort the list instead of searching
+#define SPECTATOR_MERGE_SEARCH_LIMIT 4096
+
+// Contiguous list of creatures without duplicates. A creature is only ever
+// in one map sector, so lists filled by a single map scan are appended to
+// without any lookups. Merges append everything and deduplicate once
+// afterwards, insert() of a single creature searches the list.
+//
+// The storage is taken from and given back to a scratch pool, so the lists
+// created and dropped every tick stop allocating once the pool is warm.
+// Spectator lists are only used on the dispatcher thread, the pool is not
+// locked.
+class SpectatorVec
+{
+	public:
+		typedef std::vector<Creature*>::iterator iterator;
+		typedef std::vector<Creature*>::const_iterator const_iterator;
+
+		SpectatorVec() {
+			acquire();
+		}
+		SpectatorVec(const SpectatorVec& other) {
+			acquire();
+			vec = other.vec;
+		}
+		~SpectatorVec() {
+			release();
+		}
+
+		SpectatorVec& operator=(const SpectatorVec& other) {
+			vec = other.vec;
+			return *this;
+		}
+
+		bool insert(Creature* creature) {
+			if (std::find(vec.begin(), vec.end(), creature) != vec.end()) {
+				return false;
+			}
+			vec.push_back(creature);
+			return true;
+		}
+
+		void insert(const_iterator first, const_iterator last) {
+			if (vec.empty()) {
+				vec.assign(first, last);
+			} else {
+				size_t mergedFrom = vec.size();
+				vec.insert(vec.end(), first, last);
+				removeDuplicates(mergedFrom);
+			}
+		}
+
+		// the caller guarantees that the creature is not in the list yet, or
+		// calls removeDuplicates() once it is done appending
+		void emplace_back(Creature* creature) {
+			vec.push_back(creature);
+		}
+
+		// drops the creatures appended from mergedFrom on that are already in
+		// the list before it, the appended ones must not repeat each other
+		void removeDuplicates(size_t mergedFrom) {
+			if (mergedFrom * (vec.size() - mergedFrom) <= SPECTATOR_MERGE_SEARCH_LIMIT) {
+				iterator prefixEnd = vec.begin() + mergedFrom;
+				iterator out = prefixEnd;
+				for (iterator it = prefixEnd; it != vec.end(); ++it) {
+					if (std::find(vec.begin(), prefixEnd, *it) == prefixEnd) {
+						*out++ = *it;
+					}
+				}
+				vec.erase(out, vec.end());
+			} else {
+				std::sort(vec.begin(), vec.end());
+				vec.erase(std::unique(vec.begin(), vec.end()), vec.end());
+			}
+		}
+
+		size_t size() const {
+			return vec.size();
+		}
+		bool empty() const {
+			return vec.empty();
+		}
+		void clear() {
+			vec.clear();
+		}
+
+		iterator begin() {
+			return vec.begin();
+		}
+		const_iterator begin() const {
+			return vec.begin();
+		}
+		iterator end() {
+			return vec.end();
+		}
+		const_iterator end() const {
+			return vec.end();
+		}
+
+	private:
+		void acquire();
+		void release();
+
+		std::vector<Creature*> vec;
+
+		static std::vector<std::vector<Creature*>>* pool;
+};
+
+#endif
@@ -25,6 +25,47 @@
 
 extern Game g_game;
 
+std::atomic<uint64_t> TaskFunction::heapAllocations(0);
+
+std::mutex TaskAllocator::freeBlocksLock;
+std::vector<void*> TaskAllocator::freeBlocks;
+std::atomic<uint64_t> TaskAllocator::allocations(0);
+std::atomic<uint64_t> TaskAllocator::heapAllocations(0);
+
+void* TaskAllocator::allocate(size_t size)
+{
+	assert(size <= TASK_ALLOCATOR_BLOCK_SIZE);
+	++allocations;
+
+	freeBlocksLock.lock();
+	if (!freeBlocks.empty()) {
+		void* block = freeBlocks.back();
+		freeBlocks.pop_back();
+		freeBlocksLock.unlock();
+		return block;
+	}
+	freeBlocksLock.unlock();
+
+	++heapAllocations;
+	return ::operator new(TASK_ALLOCATOR_BLOCK_SIZE);
+}
+
+void TaskAllocator::deallocate(void* block)
+{
+	if (!block) {
+		return;
+	}
+
+	freeBlocksLock.lock();
+	if (freeBlocks.size() < TASK_ALLOCATOR_MAX_FREE_BLOCKS) {
+		freeBlocks.push_back(block);
+		block = nullptr;
+	}
+	freeBlocksLock.unlock();
+
+	::operator delete(block);
+}
+
 Dispatcher::Dispatcher()
 {
 	m_threadState = THREAD_STATE_TERMINATED;
@@ -43,32 +84,41 @@ void Dispatcher::dispatcherThread()
 	// NOTE: second argument defer_lock is to prevent from immediate locking
 	std::unique_lock<std::mutex> taskLockUnique(m_taskLock, std::defer_lock);
 
+	std::vector<Task*> tmpTaskList;
+	std::vector<Task*> tmpPriorityTaskList;
 	while (m_threadState != THREAD_STATE_TERMINATED) {
 		// check if there are tasks waiting
 		taskLockUnique.lock();
 
-		if (m_taskList.empty()) {
+		if (m_taskList.empty() && m_priorityTaskList.empty()) {
 			//if the list is empty wait for signal
 			m_taskSignal.wait(taskLockUnique);
 		}
 
-		if (!m_taskList.empty() && m_threadState != THREAD_STATE_TERMINATED) {
-			// take the first task
-			Task* task = m_taskList.front();
-			m_taskList.pop_front();
+		if (m_threadState == THREAD_STATE_TERMINATED) {
 			taskLockUnique.unlock();
+			break;
+		}
 
-			if (!task->hasExpired()) {
-				// execute it
-				outputPool->startExecutionFrame();
-				(*task)();
-				outputPool->sendAll();
-
-				g_game.clearSpectatorCache();
+		// take every waiting task at once, producers keep appending to the
+		// (already allocated) buffers we hand back
+		tmpPriorityTaskList.swap(m_priorityTaskList);
+		tmpTaskList.swap(m_taskList);
+		taskLockUnique.unlock();
+
+		for (std::vector<Task*>* batch : {&tmpPriorityTaskList, &tmpTaskList}) {
+			for (Task* task : *batch) {
+				if (!task->hasExpired()) {
+					// execute it
+					outputPool->startExecutionFrame();
+					(*task)();
+					outputPool->sendAll();
+
+					g_game.trimSpectatorCache();
+				}
+				delete task;
 			}
-			delete task;
-		} else {
-			taskLockUnique.unlock();
+			batch->clear();
 		}
 	}
 }
@@ -80,10 +130,10 @@ void Dispatcher::addTask(Task* task, bool push_front /*= false*/)
 	m_taskLock.lock();
 
 	if (m_threadState == THREAD_STATE_RUNNING) {
-		do_signal = m_taskList.empty();
+		do_signal = m_taskList.empty() && m_priorityTaskList.empty();
 
 		if (push_front) {
-			m_taskList.push_front(task);
+			m_priorityTaskList.push_back(task);
 		} else {
 			m_taskList.push_back(task);
 		}
@@ -101,18 +151,24 @@ void Dispatcher::addTask(Task* task, bool push_front /*= false*/)
 
 void Dispatcher::flush()
 {
-	while (!m_taskList.empty()) {
-		Task* task = m_taskList.front();
-		m_taskList.pop_front();
-		(*task)();
-		delete task;
+	std::vector<Task*> tmpTaskList;
+	while (!m_taskList.empty() || !m_priorityTaskList.empty()) {
+		tmpTaskList.swap(m_priorityTaskList);
+		tmpTaskList.insert(tmpTaskList.end(), m_taskList.begin(), m_taskList.end());
+		m_taskList.clear();
+
+		for (Task* task : tmpTaskList) {
+			(*task)();
+			delete task;
 
-		OutputMessagePool* outputPool = OutputMessagePool::getInstance();
-		if (outputPool) {
-			outputPool->sendAll();
-		}
+			OutputMessagePool* outputPool = OutputMessagePool::getInstance();
+			if (outputPool) {
+				outputPool->sendAll();
+			}
 
-		g_game.clearSpectatorCache();
+			g_game.trimSpectatorCache();
+		}
+		tmpTaskList.clear();
 	}
 }
 
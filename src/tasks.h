@@ -20,6 +20,7 @@
 #ifndef FS_TASKS_H_A66AC384766041E59DCA059DAB6E1976
 #define FS_TASKS_H_A66AC384766041E59DCA059DAB6E1976
 
+#include <atomic>
 #include <condition_variable>
 
 #include "enums.h"
@@ -27,15 +28,165 @@
 const int DISPATCHER_TASK_EXPIRATION = 2000;
 const auto SYSTEM_TIME_ZERO = std::chrono::system_clock::time_point(std::chrono::milliseconds(0));
 
+#define TASK_FUNCTION_INLINE_SIZE 64
+#define TASK_ALLOCATOR_BLOCK_SIZE 128
+#define TASK_ALLOCATOR_MAX_FREE_BLOCKS 8192
+
+// Move-only replacement for std::function<void (void)> that stores callables
+// of up to TASK_FUNCTION_INLINE_SIZE bytes (the usual std::bind of a member
+// function and a few arguments, or a small lambda) inside the task itself.
+class TaskFunction
+{
+	public:
+		TaskFunction() : m_ops(nullptr) {}
+
+		template <typename F, typename Callable = typename std::decay<F>::type,
+		          typename = typename std::enable_if<!std::is_same<Callable, TaskFunction>::value>::type>
+		TaskFunction(F&& f) : m_ops(&Ops<Callable, FitsInline<Callable>::value>::table) {
+			Ops<Callable, FitsInline<Callable>::value>::create(&m_storage, std::forward<F>(f));
+		}
+
+		TaskFunction(TaskFunction&& other) : m_ops(other.m_ops) {
+			if (m_ops) {
+				m_ops->move(&m_storage, &other.m_storage);
+				other.m_ops = nullptr;
+			}
+		}
+
+		~TaskFunction() {
+			if (m_ops) {
+				m_ops->destroy(&m_storage);
+			}
+		}
+
+		// non-copyable
+		TaskFunction(const TaskFunction&) = delete;
+		TaskFunction& operator=(const TaskFunction&) = delete;
+
+		void operator()() {
+			m_ops->invoke(&m_storage);
+		}
+
+		static uint64_t getHeapAllocations() {
+			return heapAllocations;
+		}
+
+	private:
+		typedef typename std::aligned_storage<TASK_FUNCTION_INLINE_SIZE>::type Storage;
+
+		struct OpsTable {
+			void (*invoke)(Storage*);
+			void (*move)(Storage*, Storage*);
+			void (*destroy)(Storage*);
+		};
+
+		template <typename Callable>
+		struct FitsInline {
+			static const bool value = sizeof(Callable) <= sizeof(Storage) &&
+			                          std::alignment_of<Callable>::value <= std::alignment_of<Storage>::value &&
+			                          std::is_nothrow_move_constructible<Callable>::value;
+		};
+
+		template <typename Callable, bool Inline>
+		struct Ops;
+
+		template <typename Callable>
+		struct Ops<Callable, true> {
+			template <typename F>
+			static void create(Storage* storage, F&& f) {
+				new (storage) Callable(std::forward<F>(f));
+			}
+			static void invoke(Storage* storage) {
+				(*reinterpret_cast<Callable*>(storage))();
+			}
+			static void move(Storage* to, Storage* from) {
+				new (to) Callable(std::move(*reinterpret_cast<Callable*>(from)));
+				reinterpret_cast<Callable*>(from)->~Callable();
+			}
+			static void destroy(Storage* storage) {
+				reinterpret_cast<Callable*>(storage)->~Callable();
+			}
+			static const OpsTable table;
+		};
+
+		template <typename Callable>
+		struct Ops<Callable, false> {
+			template <typename F>
+			static void create(Storage* storage, F&& f) {
+				++heapAllocations;
+				*reinterpret_cast<Callable**>(storage) = new Callable(std::forward<F>(f));
+			}
+			static void invoke(Storage* storage) {
+				(**reinterpret_cast<Callable**>(storage))();
+			}
+			static void move(Storage* to, Storage* from) {
+				*reinterpret_cast<Callable**>(to) = *reinterpret_cast<Callable**>(from);
+			}
+			static void destroy(Storage* storage) {
+				delete *reinterpret_cast<Callable**>(storage);
+			}
+			static const OpsTable table;
+		};
+
+		Storage m_storage;
+		const OpsTable* m_ops;
+
+		static std::atomic<uint64_t> heapAllocations;
+};
+
+template <typename Callable>
+const TaskFunction::OpsTable TaskFunction::Ops<Callable, true>::table = {
+	&TaskFunction::Ops<Callable, true>::invoke,
+	&TaskFunction::Ops<Callable, true>::move,
+	&TaskFunction::Ops<Callable, true>::destroy
+};
+
+template <typename Callable>
+const TaskFunction::OpsTable TaskFunction::Ops<Callable, false>::table = {
+	&TaskFunction::Ops<Callable, false>::invoke,
+	&TaskFunction::Ops<Callable, false>::move,
+	&TaskFunction::Ops<Callable, false>::destroy
+};
+
+// Tasks are created by whichever thread queues work but almost always freed
+// by the dispatcher, so their memory is recycled through one shared free list
+// of fixed-size blocks instead of going back to the heap.
+class TaskAllocator
+{
+	public:
+		static void* allocate(size_t size);
+		static void deallocate(void* block);
+
+		static uint64_t getAllocations() {
+			return allocations;
+		}
+		static uint64_t getHeapAllocations() {
+			return heapAllocations;
+		}
+
+	private:
+		static std::mutex freeBlocksLock;
+		static std::vector<void*> freeBlocks;
+		static std::atomic<uint64_t> allocations;
+		static std::atomic<uint64_t> heapAllocations;
+};
+
 class Task
 {
 	public:
 		// DO NOT allocate this class on the stack
-		Task(uint32_t ms, const std::function<void (void)>& f) : m_f(f) {
+		Task(uint32_t ms, TaskFunction&& f) : m_f(std::move(f)) {
 			m_expiration = std::chrono::system_clock::now() + std::chrono::milliseconds(ms);
 		}
-		Task(const std::function<void (void)>& f)
-			: m_expiration(SYSTEM_TIME_ZERO), m_f(f) {}
+		explicit Task(TaskFunction&& f)
+			: m_expiration(SYSTEM_TIME_ZERO), m_f(std::move(f)) {}
+
+		static void* operator new(size_t size) {
+			return TaskAllocator::allocate(size);
+		}
+		static void operator delete(void* block) {
+			TaskAllocator::deallocate(block);
+		}
 
 		void operator()() {
 			m_f();
@@ -57,17 +208,19 @@ class Task
 		// then it is the time the task should be added to the
 		// dispatcher
 		std::chrono::system_clock::time_point m_expiration;
-		std::function<void (void)> m_f;
+		TaskFunction m_f;
 };
 
-inline Task* createTask(const std::function<void (void)>& f)
+template <typename F>
+inline Task* createTask(F&& f)
 {
-	return new Task(f);
+	return new Task(TaskFunction(std::forward<F>(f)));
 }
 
-inline Task* createTask(uint32_t expiration, const std::function<void (void)>& f)
+template <typename F>
+inline Task* createTask(uint32_t expiration, F&& f)
 {
-	return new Task(expiration, f);
+	return new Task(expiration, TaskFunction(std::forward<F>(f)));
 }
 
 class Dispatcher
@@ -78,6 +231,10 @@ class Dispatcher
 
 		void addTask(Task* task, bool push_front = false);
 
+		bool isDispatcherThread() const {
+			return std::this_thread::get_id() == m_thread.get_id();
+		}
+
 		void start();
 		void stop();
 		void shutdown();
@@ -92,7 +249,11 @@ class Dispatcher
 		std::mutex m_taskLock;
 		std::condition_variable m_taskSignal;
 
-		std::list<Task*> m_taskList;
+		// Producers only append to these while holding m_taskLock; the
+		// dispatcher thread swaps them out and runs the whole batch unlocked.
+		// Vector capacity is kept between swaps so queueing does not allocate.
+		std::vector<Task*> m_taskList;
+		std::vector<Task*> m_priorityTaskList;
 		ThreadState m_threadState;
 };
 
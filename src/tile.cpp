@@ -38,6 +38,49 @@ extern MoveEvents* g_moveEvents;
 StaticTile real_nullptr_tile(0xFFFF, 0xFFFF, 0xFFFF);
 Tile& Tile::nullptr_tile = real_nullptr_tile;
 
+TileAllocator::SizeClass TileAllocator::sizeClasses[TILE_ALLOCATOR_MAX_SIZE / TILE_ALLOCATOR_ALIGNMENT];
+uint64_t TileAllocator::usedBytes = 0;
+uint64_t TileAllocator::reservedBytes = 0;
+
+void* TileAllocator::allocate(size_t size)
+{
+	size = (size + TILE_ALLOCATOR_ALIGNMENT - 1) & ~static_cast<size_t>(TILE_ALLOCATOR_ALIGNMENT - 1);
+	assert(size <= TILE_ALLOCATOR_MAX_SIZE);
+	usedBytes += size;
+
+	SizeClass& sizeClass = sizeClasses[size / TILE_ALLOCATOR_ALIGNMENT - 1];
+	if (sizeClass.freeList) {
+		void* block = sizeClass.freeList;
+		sizeClass.freeList = *static_cast<void**>(block);
+		return block;
+	}
+
+	if (static_cast<size_t>(sizeClass.end - sizeClass.next) < size) {
+		// the tail of the previous chunk is left unused, chunks are never released
+		sizeClass.next = static_cast<char*>(::operator new(TILE_ALLOCATOR_CHUNK_SIZE));
+		sizeClass.end = sizeClass.next + TILE_ALLOCATOR_CHUNK_SIZE;
+		reservedBytes += TILE_ALLOCATOR_CHUNK_SIZE;
+	}
+
+	void* block = sizeClass.next;
+	sizeClass.next += size;
+	return block;
+}
+
+void TileAllocator::deallocate(void* block, size_t size)
+{
+	if (!block) {
+		return;
+	}
+
+	size = (size + TILE_ALLOCATOR_ALIGNMENT - 1) & ~static_cast<size_t>(TILE_ALLOCATOR_ALIGNMENT - 1);
+	usedBytes -= size;
+
+	SizeClass& sizeClass = sizeClasses[size / TILE_ALLOCATOR_ALIGNMENT - 1];
+	*static_cast<void**>(block) = sizeClass.freeList;
+	sizeClass.freeList = block;
+}
+
 bool Tile::hasProperty(enum ITEMPROPERTY prop) const
 {
 	if (ground && ground->hasProperty(prop)) {
@@ -509,14 +552,17 @@ void Tile::moveCreature(Creature* creature, Cylinder* toCylinder, bool forceTele
 	//remove the creature
 	__removeThing(creature, 0);
 
-	// Switch the node ownership
+	//add the creature
+	newTile->__addThing(creature);
+
+	// Switch the node ownership, the leaves keep a copy of the new position
 	if (qt_node != newTile->qt_node) {
 		qt_node->removeCreature(creature);
 		newTile->qt_node->addCreature(creature);
+	} else {
+		qt_node->updateCreature(creature);
 	}
 
-	//add the creature
-	newTile->__addThing(creature);
 	int32_t newStackPos = newTile->__getIndexOfThing(creature);
 
 	if (!teleport) {
@@ -908,7 +954,7 @@ void Tile::__addThing(int32_t, Thing* thing)
 {
 	Creature* creature = thing->getCreature();
 	if (creature) {
-		g_game.clearSpectatorCache();
+		qt_node->updateVersion();
 		creature->setParent(this);
 		CreatureVector* creatures = makeCreatures();
 		creatures->insert(creatures->begin(), creature);
@@ -1116,7 +1162,7 @@ void Tile::__removeThing(Thing* thing, uint32_t count)
 		if (creatures) {
 			CreatureVector::iterator it = std::find(creatures->begin(), creatures->end(), thing);
 			if (it != creatures->end()) {
-				g_game.clearSpectatorCache();
+				qt_node->updateVersion();
 				creatures->erase(it);
 			}
 		}
@@ -1517,7 +1563,7 @@ void Tile::__internalAddThing(uint32_t, Thing* thing)
 
 	Creature* creature = thing->getCreature();
 	if (creature) {
-		g_game.clearSpectatorCache();
+		qt_node->updateVersion();
 		CreatureVector* creatures = makeCreatures();
 		creatures->insert(creatures->begin(), creature);
 	} else {
@@ -1526,31 +1572,34 @@ void Tile::__internalAddThing(uint32_t, Thing* thing)
 			return;
 		}
 
-		TileItemVector* items = makeItemList();
-		if (items->size() >= 0xFFFF) {
-			return /*RETURNVALUE_NOTPOSSIBLE*/;
-		}
-
 		if (item->isGroundTile()) {
 			if (ground == nullptr) {
 				ground = item;
 			}
-		} else if (item->isAlwaysOnTop()) {
-			bool isInserted = false;
-			for (ItemVector::iterator it = items->getBeginTopItem(); it != items->getEndTopItem(); ++it) {
-				if (Item::items[(*it)->getID()].alwaysOnTopOrder > Item::items[item->getID()].alwaysOnTopOrder) {
-					items->insert(it, item);
-					isInserted = true;
-					break;
-				}
+		} else {
+			// bare ground must not allocate a list on tiles that keep them lazily
+			TileItemVector* items = makeItemList();
+			if (items->size() >= 0xFFFF) {
+				return /*RETURNVALUE_NOTPOSSIBLE*/;
 			}
 
-			if (!isInserted) {
-				items->push_back(item);
+			if (item->isAlwaysOnTop()) {
+				bool isInserted = false;
+				for (ItemVector::iterator it = items->getBeginTopItem(); it != items->getEndTopItem(); ++it) {
+					if (Item::items[(*it)->getID()].alwaysOnTopOrder > Item::items[item->getID()].alwaysOnTopOrder) {
+						items->insert(it, item);
+						isInserted = true;
+						break;
+					}
+				}
+
+				if (!isInserted) {
+					items->push_back(item);
+				}
+			} else {
+				items->insert(items->getBeginDownItem(), item);
+				++items->downItemCount;
 			}
-		} else {
-			items->insert(items->getBeginDownItem(), item);
-			++items->downItemCount;
 		}
 
 		updateTileFlags(item, false);
@@ -1559,6 +1608,8 @@ void Tile::__internalAddThing(uint32_t, Thing* thing)
 
 void Tile::updateTileFlags(Item* item, bool removing)
 {
+	const uint32_t oldFlags = m_flags;
+
 	if (!removing) {
 		//!removing is adding an item to the tile
 		if (!hasFlag(TILESTATE_FLOORCHANGE)) {
@@ -1646,6 +1697,10 @@ void Tile::updateTileFlags(Item* item, bool removing)
 		if (item->hasProperty(CONST_PROP_SUPPORTHANGABLE)) {
 			setFlag(TILESTATE_SUPPORTS_HANGABLE);
 		}
+
+		if (item->hasProperty(CONST_PROP_BLOCKPROJECTILE)) {
+			setFlag(TILESTATE_BLOCKPROJECTILE);
+		}
 	} else {
 		if (item->floorChangeDown()) {
 			resetFlag(TILESTATE_FLOORCHANGE);
@@ -1734,6 +1789,24 @@ void Tile::updateTileFlags(Item* item, bool removing)
 		if (item->hasProperty(CONST_PROP_SUPPORTHANGABLE)) {
 			resetFlag(TILESTATE_SUPPORTS_HANGABLE);
 		}
+
+		if (item->hasProperty(CONST_PROP_BLOCKPROJECTILE) && !hasProperty(item, CONST_PROP_BLOCKPROJECTILE)) {
+			resetFlag(TILESTATE_BLOCKPROJECTILE);
+		}
+	}
+
+	if (!qt_node) {
+		// not placed on the map yet, Map::setTile picks up the final flags
+		return;
+	}
+
+	// e.g. a door was opened or closed
+	if (((oldFlags ^ m_flags) & (TILESTATE_FLOORCHANGE | TILESTATE_TELEPORT | TILESTATE_BLOCKSOLID)) != 0) {
+		g_game.getMap()->invalidateSector(getPosition());
+	}
+
+	if (((oldFlags ^ m_flags) & TILESTATE_BLOCKPROJECTILE) != 0) {
+		g_game.getMap()->setSightBlock(getPosition(), hasFlag(TILESTATE_BLOCKPROJECTILE));
 	}
 }
 
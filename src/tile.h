@@ -25,6 +25,7 @@
 #include "cylinder.h"
 #include "item.h"
 #include "tools.h"
+#include "spectators.h"
 
 class Creature;
 class Teleport;
@@ -35,9 +36,12 @@ class QTreeLeafNode;
 class BedItem;
 
 typedef std::vector<Creature*> CreatureVector;
-typedef std::unordered_set<Creature*> SpectatorVec;
 typedef std::vector<Item*> ItemVector;
 
+#define TILE_ALLOCATOR_CHUNK_SIZE (1 << 20)
+#define TILE_ALLOCATOR_ALIGNMENT 8
+#define TILE_ALLOCATOR_MAX_SIZE 256
+
 enum tileflags_t {
 	TILESTATE_NONE = 0,
 	TILESTATE_PROTECTIONZONE = 1,
@@ -70,7 +74,8 @@ enum tileflags_t {
 	TILESTATE_DYNAMIC_TILE = 33554432,
 	TILESTATE_FLOORCHANGE_SOUTH_ALT = 67108864,
 	TILESTATE_FLOORCHANGE_EAST_ALT = 134217728,
-	TILESTATE_SUPPORTS_HANGABLE = 268435456
+	TILESTATE_SUPPORTS_HANGABLE = 268435456,
+	TILESTATE_BLOCKPROJECTILE = 536870912
 };
 
 enum ZoneType_t {
@@ -181,6 +186,34 @@ class TileItemVector
 		friend class Tile;
 };
 
+// A full map holds tens of millions of tiles that live until shutdown, so
+// they are carved out of large chunks instead of one heap block each. Freed
+// tiles go to a free list per size class. Only used by the dispatcher thread.
+class TileAllocator
+{
+	public:
+		static void* allocate(size_t size);
+		static void deallocate(void* block, size_t size);
+
+		static uint64_t getUsedBytes() {
+			return usedBytes;
+		}
+		static uint64_t getReservedBytes() {
+			return reservedBytes;
+		}
+
+	private:
+		struct SizeClass {
+			void* freeList = nullptr;
+			char* next = nullptr;
+			char* end = nullptr;
+		};
+
+		static SizeClass sizeClasses[TILE_ALLOCATOR_MAX_SIZE / TILE_ALLOCATOR_ALIGNMENT];
+		static uint64_t usedBytes;
+		static uint64_t reservedBytes;
+};
+
 class Tile : public Cylinder
 {
 	public:
@@ -188,6 +221,13 @@ class Tile : public Cylinder
 		Tile(uint16_t x, uint16_t y, uint16_t z);
 		~Tile();
 
+		static void* operator new(size_t size) {
+			return TileAllocator::allocate(size);
+		}
+		static void operator delete(void* block, size_t size) {
+			TileAllocator::deallocate(block, size);
+		}
+
 		TileItemVector* getItemList();
 		const TileItemVector* getItemList() const;
 		TileItemVector* makeItemList();
@@ -238,6 +278,9 @@ class Tile : public Cylinder
 		bool hasFlag(tileflags_t flag) const {
 			return hasBitSet(flag, m_flags);
 		}
+		uint32_t getFlags() const {
+			return m_flags;
+		}
 		void setFlag(tileflags_t flag) {
 			m_flags |= static_cast<uint32_t>(flag);
 		}
@@ -393,7 +436,7 @@ class DynamicTile : public Tile
 		}
 };
 
-// For blocking tiles, where we very rarely actually have items
+// For blocking tiles and bare ground, where we very rarely actually have items
 class StaticTile final : public Tile
 {
 	// We very rarely even need the vectors, so don't keep them in memory
@@ -21,6 +21,11 @@
 
 #include <cctype>
 #include <climits>
+#include <fstream>
+
+#ifdef __linux__
+#include <unistd.h>
+#endif
 
 #include "tools.h"
 #include "configmanager.h"
@@ -1116,6 +1121,18 @@ const char* getReturnMessage(ReturnValue value)
 	}
 }
 
+uint64_t getResidentMemory()
+{
+#ifdef __linux__
+	std::ifstream statm("/proc/self/statm");
+	uint64_t totalPages, residentPages;
+	if (statm >> totalPages >> residentPages) {
+		return residentPages * sysconf(_SC_PAGESIZE);
+	}
+#endif
+	return 0;
+}
+
 #if !defined(_MSC_VER) || _MSC_VER < 1800
 double round(double v)
 {
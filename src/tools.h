@@ -87,6 +87,9 @@ itemAttrTypes stringToItemAttribute(const std::string& str);
 
 const char* getReturnMessage(ReturnValue value);
 
+// resident set size of the process in bytes, 0 where it can't be read
+uint64_t getResidentMemory();
+
 #if !defined(_MSC_VER) || _MSC_VER < 1800
 double round(double v);
 #endif
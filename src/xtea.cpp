@@ -0,0 +1,261 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2014  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "otpch.h"
+
+#include "xtea.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define XTEA_SSE2
+#include <emmintrin.h>
+#if defined(_MSC_VER) || defined(__GNUC__)
+#define XTEA_AVX2
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define XTEA_TARGET_AVX2
+#else
+#define XTEA_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+#endif
+
+#define XTEA_ROUNDS 32
+
+namespace {
+
+// Every block is encrypted with the same key, so the round keys
+// (sum + k[...]) are the same for all of them and computed only once
+// per message, leaving just the shift/add/xor work per block.
+struct RoundKeys
+{
+	uint32_t first[XTEA_ROUNDS];
+	uint32_t second[XTEA_ROUNDS];
+};
+
+const uint32_t delta = 0x61C88647;
+
+void getEncryptKeys(const uint32_t* k, RoundKeys& keys)
+{
+	uint32_t sum = 0;
+	for (int32_t i = 0; i < XTEA_ROUNDS; ++i) {
+		keys.first[i] = sum + k[sum & 3];
+		sum -= delta;
+		keys.second[i] = sum + k[(sum >> 11) & 3];
+	}
+}
+
+void getDecryptKeys(const uint32_t* k, RoundKeys& keys)
+{
+	uint32_t sum = 0xC6EF3720;
+	for (int32_t i = 0; i < XTEA_ROUNDS; ++i) {
+		keys.first[i] = sum + k[(sum >> 11) & 3];
+		sum += delta;
+		keys.second[i] = sum + k[sum & 3];
+	}
+}
+
+void encryptScalar(uint32_t* buffer, size_t blocks, const RoundKeys& keys)
+{
+	for (size_t n = 0; n < blocks; ++n) {
+		uint32_t v0 = buffer[0], v1 = buffer[1];
+		for (int32_t i = 0; i < XTEA_ROUNDS; ++i) {
+			v0 += ((v1 << 4 ^ v1 >> 5) + v1) ^ keys.first[i];
+			v1 += ((v0 << 4 ^ v0 >> 5) + v0) ^ keys.second[i];
+		}
+		*buffer++ = v0;
+		*buffer++ = v1;
+	}
+}
+
+void decryptScalar(uint32_t* buffer, size_t blocks, const RoundKeys& keys)
+{
+	for (size_t n = 0; n < blocks; ++n) {
+		uint32_t v0 = buffer[0], v1 = buffer[1];
+		for (int32_t i = 0; i < XTEA_ROUNDS; ++i) {
+			v1 -= ((v0 << 4 ^ v0 >> 5) + v0) ^ keys.first[i];
+			v0 -= ((v1 << 4 ^ v1 >> 5) + v1) ^ keys.second[i];
+		}
+		*buffer++ = v0;
+		*buffer++ = v1;
+	}
+}
+
+#ifdef XTEA_SSE2
+// four blocks per iteration: the v0 and v1 halves of the blocks are split
+// into separate registers, run through the rounds and interleaved back
+size_t encryptSSE2(uint32_t* buffer, size_t blocks, const RoundKeys& keys)
+{
+	size_t n = 0;
+	for (; n + 4 <= blocks; n += 4, buffer += 8) {
+		__m128i* ptr = reinterpret_cast<__m128i*>(buffer);
+		__m128 lo = _mm_castsi128_ps(_mm_loadu_si128(ptr));
+		__m128 hi = _mm_castsi128_ps(_mm_loadu_si128(ptr + 1));
+		__m128i v0 = _mm_castps_si128(_mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0)));
+		__m128i v1 = _mm_castps_si128(_mm_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1)));
+
+		for (int32_t i = 0; i < XTEA_ROUNDS; ++i) {
+			__m128i t = _mm_add_epi32(_mm_xor_si128(_mm_slli_epi32(v1, 4), _mm_srli_epi32(v1, 5)), v1);
+			v0 = _mm_add_epi32(v0, _mm_xor_si128(t, _mm_set1_epi32(keys.first[i])));
+			t = _mm_add_epi32(_mm_xor_si128(_mm_slli_epi32(v0, 4), _mm_srli_epi32(v0, 5)), v0);
+			v1 = _mm_add_epi32(v1, _mm_xor_si128(t, _mm_set1_epi32(keys.second[i])));
+		}
+
+		_mm_storeu_si128(ptr, _mm_unpacklo_epi32(v0, v1));
+		_mm_storeu_si128(ptr + 1, _mm_unpackhi_epi32(v0, v1));
+	}
+	return n;
+}
+
+size_t decryptSSE2(uint32_t* buffer, size_t blocks, const RoundKeys& keys)
+{
+	size_t n = 0;
+	for (; n + 4 <= blocks; n += 4, buffer += 8) {
+		__m128i* ptr = reinterpret_cast<__m128i*>(buffer);
+		__m128 lo = _mm_castsi128_ps(_mm_loadu_si128(ptr));
+		__m128 hi = _mm_castsi128_ps(_mm_loadu_si128(ptr + 1));
+		__m128i v0 = _mm_castps_si128(_mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0)));
+		__m128i v1 = _mm_castps_si128(_mm_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1)));
+
+		for (int32_t i = 0; i < XTEA_ROUNDS; ++i) {
+			__m128i t = _mm_add_epi32(_mm_xor_si128(_mm_slli_epi32(v0, 4), _mm_srli_epi32(v0, 5)), v0);
+			v1 = _mm_sub_epi32(v1, _mm_xor_si128(t, _mm_set1_epi32(keys.first[i])));
+			t = _mm_add_epi32(_mm_xor_si128(_mm_slli_epi32(v1, 4), _mm_srli_epi32(v1, 5)), v1);
+			v0 = _mm_sub_epi32(v0, _mm_xor_si128(t, _mm_set1_epi32(keys.second[i])));
+		}
+
+		_mm_storeu_si128(ptr, _mm_unpacklo_epi32(v0, v1));
+		_mm_storeu_si128(ptr + 1, _mm_unpackhi_epi32(v0, v1));
+	}
+	return n;
+}
+#endif
+
+#ifdef XTEA_AVX2
+// eight blocks per iteration, the 256-bit shuffles work per 128-bit lane
+// so the blocks are reordered inside the registers, but unpacking undoes
+// exactly that permutation
+XTEA_TARGET_AVX2 size_t encryptAVX2(uint32_t* buffer, size_t blocks, const RoundKeys& keys)
+{
+	size_t n = 0;
+	for (; n + 8 <= blocks; n += 8, buffer += 16) {
+		__m256i* ptr = reinterpret_cast<__m256i*>(buffer);
+		__m256 lo = _mm256_castsi256_ps(_mm256_loadu_si256(ptr));
+		__m256 hi = _mm256_castsi256_ps(_mm256_loadu_si256(ptr + 1));
+		__m256i v0 = _mm256_castps_si256(_mm256_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0)));
+		__m256i v1 = _mm256_castps_si256(_mm256_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1)));
+
+		for (int32_t i = 0; i < XTEA_ROUNDS; ++i) {
+			__m256i t = _mm256_add_epi32(_mm256_xor_si256(_mm256_slli_epi32(v1, 4), _mm256_srli_epi32(v1, 5)), v1);
+			v0 = _mm256_add_epi32(v0, _mm256_xor_si256(t, _mm256_set1_epi32(keys.first[i])));
+			t = _mm256_add_epi32(_mm256_xor_si256(_mm256_slli_epi32(v0, 4), _mm256_srli_epi32(v0, 5)), v0);
+			v1 = _mm256_add_epi32(v1, _mm256_xor_si256(t, _mm256_set1_epi32(keys.second[i])));
+		}
+
+		_mm256_storeu_si256(ptr, _mm256_unpacklo_epi32(v0, v1));
+		_mm256_storeu_si256(ptr + 1, _mm256_unpackhi_epi32(v0, v1));
+	}
+	return n;
+}
+
+XTEA_TARGET_AVX2 size_t decryptAVX2(uint32_t* buffer, size_t blocks, const RoundKeys& keys)
+{
+	size_t n = 0;
+	for (; n + 8 <= blocks; n += 8, buffer += 16) {
+		__m256i* ptr = reinterpret_cast<__m256i*>(buffer);
+		__m256 lo = _mm256_castsi256_ps(_mm256_loadu_si256(ptr));
+		__m256 hi = _mm256_castsi256_ps(_mm256_loadu_si256(ptr + 1));
+		__m256i v0 = _mm256_castps_si256(_mm256_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0)));
+		__m256i v1 = _mm256_castps_si256(_mm256_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1)));
+
+		for (int32_t i = 0; i < XTEA_ROUNDS; ++i) {
+			__m256i t = _mm256_add_epi32(_mm256_xor_si256(_mm256_slli_epi32(v0, 4), _mm256_srli_epi32(v0, 5)), v0);
+			v1 = _mm256_sub_epi32(v1, _mm256_xor_si256(t, _mm256_set1_epi32(keys.first[i])));
+			t = _mm256_add_epi32(_mm256_xor_si256(_mm256_slli_epi32(v1, 4), _mm256_srli_epi32(v1, 5)), v1);
+			v0 = _mm256_sub_epi32(v0, _mm256_xor_si256(t, _mm256_set1_epi32(keys.second[i])));
+		}
+
+		_mm256_storeu_si256(ptr, _mm256_unpacklo_epi32(v0, v1));
+		_mm256_storeu_si256(ptr + 1, _mm256_unpackhi_epi32(v0, v1));
+	}
+	return n;
+}
+
+bool hasAVX2()
+{
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7) {
+		return false;
+	}
+
+	// the OS must save the ymm registers as well
+	__cpuid(info, 1);
+	if ((info[2] & (1 << 27)) == 0 || (_xgetbv(0) & 6) != 6) {
+		return false;
+	}
+
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+
+// resolved once during static initialization, before any network thread runs
+const bool useAVX2 = hasAVX2();
+#endif
+
+}
+
+void xteaEncrypt(uint32_t* buffer, size_t blocks, const uint32_t* key)
+{
+	RoundKeys keys;
+	getEncryptKeys(key, keys);
+
+	size_t done = 0;
+#ifdef XTEA_AVX2
+	if (useAVX2) {
+		done = encryptAVX2(buffer, blocks, keys);
+	}
+#endif
+#ifdef XTEA_SSE2
+	done += encryptSSE2(buffer + done * 2, blocks - done, keys);
+#endif
+	encryptScalar(buffer + done * 2, blocks - done, keys);
+}
+
+void xteaDecrypt(uint32_t* buffer, size_t blocks, const uint32_t* key)
+{
+	RoundKeys keys;
+	getDecryptKeys(key, keys);
+
+	size_t done = 0;
+#ifdef XTEA_AVX2
+	if (useAVX2) {
+		done = decryptAVX2(buffer, blocks, keys);
+	}
+#endif
+#ifdef XTEA_SSE2
+	done += decryptSSE2(buffer + done * 2, blocks - done, keys);
+#endif
+	decryptScalar(buffer + done * 2, blocks - done, keys);
+}
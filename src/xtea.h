@@ -0,0 +1,29 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2014  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef FS_XTEA_H_4F2B4A9C6E1D4D7A8E3C5B1F0A9D2E67
+#define FS_XTEA_H_4F2B4A9C6E1D4D7A8E3C5B1F0A9D2E67
+
+// Encrypts/decrypts 'blocks' consecutive 8-byte XTEA blocks in place.
+// Several blocks are processed at once with SSE2 or AVX2 when the CPU
+// supports it, the result is identical to the plain scalar routine.
+void xteaEncrypt(uint32_t* buffer, size_t blocks, const uint32_t* key);
+void xteaDecrypt(uint32_t* buffer, size_t blocks, const uint32_t* key);
+
+#endif